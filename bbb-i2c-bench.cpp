@@ -0,0 +1,229 @@
+/*
+ * bbb-i2c-bench.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Google Benchmark suite for the I2CBus hot paths: Read,
+ *    Write(uint8_t*), Write(const string&), and Xfer, run against
+ *    an I2CSimBus so that it needs no hardware.
+ *
+ *    Each benchmark runs on a persistent and a non-persistent bus,
+ *    with 1, 2, 4, and 8 threads sharing the bus. Besides ns/op,
+ *    it reports, per operation:
+ *
+ *      syscalls    - backend calls, as counted in I2CStats
+ *      allocs      - calls to operator new
+ *      lockwaits   - operations that found the bus busy
+ *      lockwait_ns - time spent waiting for the bus
+ *
+ *    The persistent and non-persistent rows together give the
+ *    system calls that a persistent bus saves per transaction.
+ *    BM_ReadNack measures the error path, a read from an absent
+ *    device.
+ *
+ *    Build and run, for instance:
+ *      g++ -std=c++11 -O2 -pthread bbb-i2c-bench.cpp bbb-i2c.cpp \
+ *          bbb-i2c-sim.cpp -lbenchmark -lrt -o bbb-i2c-bench
+ *      ./bbb-i2c-bench
+ */
+
+
+#include <atomic>            // atomic
+#include <benchmark/benchmark.h>
+#include <memory>            // shared_ptr, make_shared
+#include <new>               // bad_alloc
+#include <stdint.h>          // uint8_t
+#include <stdlib.h>          // malloc(), free()
+#include <string>            // string
+
+#include "bbb-i2c.hpp"
+#include "bbb-i2c-sim.hpp"
+
+
+using namespace std;
+using namespace bbbi2c;
+
+
+// Allocation counter. The replacements are kept out of line, or
+// GCC reports the free() as mismatched with the new.
+
+static atomic<unsigned long> allocs(0);
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    allocs.fetch_add(1, memory_order_relaxed);
+
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+
+const uint8_t BENCH_ADDR   = 0x48;   // Simulated device.
+const uint8_t BENCH_ABSENT = 0x50;   // No device here.
+
+/*
+ * struct BenchBuses
+ *
+ * Description:
+ *   One persistent and one non-persistent bus, on one simulated
+ *   bus with a register device at BENCH_ADDR. Wire time is counted
+ *   but not slept.
+ */
+struct BenchBuses
+{
+    shared_ptr<I2CSimBus>  sim;
+    I2CSimRegisters        dev;
+    shared_ptr<I2CBus>     buses[2];
+
+    BenchBuses ()
+    {
+        sim = make_shared<I2CSimBus>();
+        sim->Attach(BENCH_ADDR, &dev);
+        buses[0] = make_shared<I2CBus>(sim, false);
+        buses[1] = make_shared<I2CBus>(sim, true);
+    }
+};
+
+/*
+ * static I2CBus& Bus(bool persist)
+ *
+ * Description:
+ *   Returns the bus for a benchmark. The buses are created on first
+ *   use, which may come from several benchmark threads at once.
+ */
+static I2CBus& Bus(bool persist)
+{
+    static BenchBuses bb;
+
+    return *bb.buses[persist ? 1 : 0];
+}
+
+/*
+ * template <typename Op> static void Run(benchmark::State& state, Op op)
+ *
+ * Description:
+ *   Runs op in the benchmark loop on the bus selected by
+ *   state.range(0), and reports the per-operation counters. The
+ *   counters are bus-wide, so thread 0 alone samples them, before
+ *   the threads start and after they have all stopped.
+ */
+template <typename Op>
+static void Run(benchmark::State& state, Op op)
+{
+    I2CBus&       bus = Bus(state.range(0) != 0);
+    I2CStats      st0;
+    unsigned long al0 = 0;
+
+    if (state.thread_index() == 0)
+    {
+        bus.ResetStats();
+        st0 = bus.GetStats();
+        al0 = allocs.load();
+    }
+
+    for (auto _ : state)
+        op(bus);
+
+    if (state.thread_index() == 0)
+    {
+        unsigned long al1 = allocs.load();
+        I2CStats      st1 = bus.GetStats();
+
+        typedef benchmark::Counter Counter;
+        state.counters["syscalls"]    = Counter(st1.syscalls - st0.syscalls, Counter::kAvgIterations);
+        state.counters["allocs"]      = Counter(al1 - al0, Counter::kAvgIterations);
+        state.counters["lockwaits"]   = Counter(st1.lockwaits - st0.lockwaits, Counter::kAvgIterations);
+        state.counters["lockwait_ns"] = Counter(st1.lockwaitns - st0.lockwaitns, Counter::kAvgIterations);
+    }
+
+    state.SetLabel(state.range(0) ? "persistent" : "open/close");
+}
+
+static void BM_Read(benchmark::State& state)
+{
+    Run(state, [](I2CBus& bus)
+    {
+        uint8_t data[2];
+        bus.Read(data, sizeof(data), BENCH_ADDR);
+        benchmark::DoNotOptimize(data);
+    });
+}
+
+static void BM_Write(benchmark::State& state)
+{
+    Run(state, [](I2CBus& bus)
+    {
+        uint8_t data[2] = { 0x10, 0x55 };
+        bus.Write(data, sizeof(data), BENCH_ADDR);
+    });
+}
+
+static void BM_WriteString(benchmark::State& state)
+{
+    const string dat("\x10\x55", 2);
+
+    Run(state, [&dat](I2CBus& bus)
+    {
+        bus.Write(dat, BENCH_ADDR);
+    });
+}
+
+static void BM_Xfer(benchmark::State& state)
+{
+    Run(state, [](I2CBus& bus)
+    {
+        uint8_t reg = 0x10;
+        uint8_t data[2];
+        bus.Xfer(&reg, 1, data, sizeof(data), BENCH_ADDR);
+        benchmark::DoNotOptimize(data);
+    });
+}
+
+static void BM_ReadNack(benchmark::State& state)
+{
+    Run(state, [](I2CBus& bus)
+    {
+        uint8_t data[2];
+        try
+        {
+            bus.Read(data, sizeof(data), BENCH_ABSENT);
+        }
+        catch (I2CException&)
+        { }
+    });
+}
+
+/*
+ * static void Args(benchmark::internal::Benchmark* b)
+ *
+ * Description:
+ *   Both bus modes, at 1, 2, 4, and 8 threads, timed by the wall
+ *   clock.
+ */
+static void Args(benchmark::internal::Benchmark* b)
+{
+    b->ArgName("persist")->Arg(0)->Arg(1);
+    b->ThreadRange(1, 8)->UseRealTime();
+}
+
+BENCHMARK(BM_Read)->Apply(Args);
+BENCHMARK(BM_Write)->Apply(Args);
+BENCHMARK(BM_WriteString)->Apply(Args);
+BENCHMARK(BM_Xfer)->Apply(Args);
+BENCHMARK(BM_ReadNack)->Apply(Args);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,133 @@
+/*
+ * bbb-i2c-broker-test.cpp
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Checks that one broker client cannot fail another's requests.
+ *
+ *    Two clients share a broker on a simulated bus. One keeps
+ *    reading from an address where no device answers, while the
+ *    other reads registers from a device that is present. The
+ *    broker's queue merges their requests whenever both are
+ *    waiting, so the merged transfers fail; each request must
+ *    nevertheless receive only its own result.
+ *
+ *    Build and run, for instance:
+ *      g++ -std=c++11 -pthread bbb-i2c-broker-test.cpp \
+ *          bbb-i2c-broker.cpp bbb-i2c-queue.cpp bbb-i2c.cpp \
+ *          bbb-i2c-sim.cpp -lrt -o bbb-i2c-broker-test
+ *      ./bbb-i2c-broker-test
+ *
+ *    Exits with 0 if every check passed, 1 otherwise.
+ */
+
+
+#include <atomic>            // atomic
+#include <iostream>          // cout, cerr, endl
+#include <memory>            // shared_ptr, make_shared
+#include <stdint.h>          // uint8_t
+#include <string>            // string, to_string()
+#include <thread>            // thread
+#include <unistd.h>          // getpid()
+
+#include "bbb-i2c.hpp"
+#include "bbb-i2c-broker.hpp"
+#include "bbb-i2c-sim.hpp"
+
+
+using namespace std;
+using namespace bbbi2c;
+
+
+const uint8_t TEST_BUS    = 1;      // Broker bus number.
+const uint8_t TEST_ADDR   = 0x40;   // Simulated device.
+const uint8_t TEST_ABSENT = 0x50;   // No device here.
+const int     TEST_ROUNDS = 2000;   // Requests per client.
+
+
+int main()
+{
+    string sockpath = "/tmp/bbb-i2c-broker-test." + to_string(getpid());
+
+    auto            sim = make_shared<I2CSimBus>();
+    I2CSimRegisters dev;
+
+    sim->Attach(TEST_ADDR, &dev);
+    for (int r = 0; r < 256; r++)
+        dev.Poke(r, r);
+
+    atomic<int> goodok(0), goodfail(0), goodbad(0);
+    atomic<int> missok(0), missfail(0);
+
+    try
+    {
+        I2CBroker brk(sockpath.c_str());
+        brk.AddBus(TEST_BUS, make_shared<I2CBus>(sim, true));
+
+        thread server([&brk] { brk.Run(); });
+
+        I2CBrokerClient good(sockpath.c_str());
+        I2CBrokerClient miss(sockpath.c_str());
+
+        thread tgood([&]
+        {
+            for (int k = 0; k < TEST_ROUNDS; k++)
+            {
+                uint8_t reg = (uint8_t)k;
+                uint8_t val = 0;
+                try
+                {
+                    good.Xfer(TEST_BUS, &reg, 1, &val, 1, TEST_ADDR);
+                    goodok++;
+                    if (val != reg)
+                        goodbad++;
+                }
+                catch (I2CException&)
+                {
+                    goodfail++;
+                }
+            }
+        });
+
+        thread tmiss([&]
+        {
+            for (int k = 0; k < TEST_ROUNDS; k++)
+            {
+                uint8_t reg = (uint8_t)k;
+                uint8_t val = 0;
+                try
+                {
+                    miss.Xfer(TEST_BUS, &reg, 1, &val, 1, TEST_ABSENT);
+                    missok++;
+                }
+                catch (I2CException&)
+                {
+                    missfail++;
+                }
+            }
+        });
+
+        tgood.join();
+        tmiss.join();
+
+        brk.Stop();
+        server.join();
+    }
+    catch (I2CException& iexc)
+    {
+        cerr << "bbb-i2c-broker-test: " << iexc.who() << ": " << iexc.why() << endl;
+        return 1;
+    }
+
+    cout << "present: " << goodok << " ok, " << goodfail << " failed, "
+         << goodbad << " wrong" << endl;
+    cout << "absent:  " << missok << " ok, " << missfail << " failed" << endl;
+
+    bool pass = goodok == TEST_ROUNDS && goodbad == 0 &&
+                missfail == TEST_ROUNDS;
+
+    cout << (pass ? "PASS" : "FAIL") << endl;
+    return pass ? 0 : 1;
+}
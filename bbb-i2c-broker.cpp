@@ -0,0 +1,896 @@
+/*
+ * bbb-i2c-broker.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements the I2C broker and its client.
+ */
+
+
+#include "bbb-i2c-broker.hpp"
+
+#include <errno.h>           // errno, EINTR, EAGAIN
+#include <exception>         // exception_ptr
+#include <fcntl.h>           // O_CLOEXEC, O_NONBLOCK
+#include <map>               // map
+#include <memory>            // shared_ptr, make_shared
+#include <mutex>             // mutex, lock_guard
+#include <poll.h>            // poll(), pollfd
+#include <sstream>           // stringstream
+#include <stdint.h>          // uint8_t, uint16_t, uint32_t
+#include <string.h>          // memcpy, strncpy
+#include <sys/socket.h>      // socket(), bind(), listen(), accept4(), send(), recv()
+#include <sys/stat.h>        // chmod()
+#include <sys/un.h>          // sockaddr_un
+#include <unistd.h>          // close(), unlink(), pipe2(), read(), write()
+#include <vector>            // vector
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+// I2CBroker Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CBroker::I2CBroker(const char* sockpath, int mode)
+ *
+ * Description:
+ *   Constructor. Creates the listening socket, replacing any stale
+ *   socket file left at the same path.
+ *
+ *   Any process that can connect to the socket can drive the
+ *   buses, so the mode should grant access only to trusted users.
+ *   It is set on the socket file before the broker listens, and
+ *   does not depend on the umask.
+ *
+ * Parameters:
+ *   sockpath - Unix domain socket path, such as "/run/bbb-i2cd.sock"
+ *   mode     - permission bits of the socket file. Defaults to 0600.
+ *
+ * Exceptions:
+ *   I2CException - the socket cannot be created.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+I2CBroker::I2CBroker(const char* sockpath, int mode)
+{
+    struct sockaddr_un sa;
+
+    path = sockpath;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strncpy(sa.sun_path, sockpath, sizeof(sa.sun_path) - 1);
+
+    unlink(sockpath);
+
+    lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ( lfd < 0 ||
+         bind(lfd, (struct sockaddr*)&sa, sizeof(sa)) < 0 ||
+         chmod(sockpath, mode) < 0 ||
+         listen(lfd, 16) < 0 ||
+         pipe2(stopfd, O_CLOEXEC | O_NONBLOCK) < 0 )
+    {
+        if (lfd >= 0)
+            close(lfd);
+
+        stringstream ss;
+        ss << "Unable to listen on " << path;
+        I2CException iexc(ss.str(), "I2CBroker::I2CBroker(sockpath, mode)");
+        throw iexc;
+    }
+}
+
+/*
+ * I2CBroker::~I2CBroker()
+ *
+ * Description:
+ *   Destructor. Lets each bus queue finish, then closes the
+ *   listening socket and removes the socket file.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+I2CBroker::~I2CBroker()
+{
+    buses.clear();
+
+    close(lfd);
+    close(stopfd[0]);
+    close(stopfd[1]);
+    unlink(path.c_str());
+}
+
+
+// I2CBroker Protected
+// ------------------------------------------------------------------
+
+/*
+ * bool I2CBroker::Receive(shared_ptr<Client> client)
+ *
+ * Description:
+ *   Reads whatever a client has sent and queues every complete
+ *   request in it. Returns false if the client has gone, or has
+ *   sent something that cannot be framed, and should be dropped.
+ *
+ * Parameters:
+ *   client - the client
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+bool I2CBroker::Receive(shared_ptr<Client> client)
+{
+    uint8_t buf[4096];
+
+    ssize_t n = recv(client->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n < 0)
+        return errno == EINTR || errno == EAGAIN;
+    if (n == 0)
+        return false;
+
+    client->in.insert(client->in.end(), buf, buf + n);
+
+    int rc;
+    while ((rc = this->Parse(client)) > 0)
+    { }
+
+    return rc == 0;
+}
+
+/*
+ * int I2CBroker::Parse(shared_ptr<Client> client)
+ *
+ * Description:
+ *   Takes one request off the front of a client's input and
+ *   queues it on its bus. Returns 1 if a request was taken, 0 if
+ *   the input does not yet hold a whole request, or -1 if the
+ *   request header is unusable.
+ *
+ *   A request that is framed correctly but cannot be carried out
+ *   is answered with an error status.
+ *
+ * Parameters:
+ *   client - the client
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+int I2CBroker::Parse(shared_ptr<Client> client)
+{
+    vector<uint8_t>& in = client->in;
+    I2CReqHeader     hdr;
+
+    if (in.size() < sizeof(hdr))
+        return 0;
+
+    memcpy(&hdr, in.data(), sizeof(hdr));
+
+    if (hdr.nsegs == 0 || hdr.nsegs > I2C_BROKER_MAXSEGS || hdr.wlen > I2C_BROKER_MAXDATA)
+    {
+        this->Reply(*client, hdr.id, I2C_ERR_REQUEST, nullptr, 0);
+        return -1;
+    }
+
+    size_t seglen = hdr.nsegs * sizeof(I2CSegment);
+    size_t need   = sizeof(hdr) + seglen + hdr.wlen;
+    if (in.size() < need)
+        return 0;
+
+    auto req = make_shared<Request>();
+    req->client = client;
+    req->hdr    = hdr;
+
+    vector<I2CSegment> segs(hdr.nsegs);
+    memcpy(segs.data(), in.data() + sizeof(hdr), seglen);
+    req->wdata.assign(in.begin() + sizeof(hdr) + seglen, in.begin() + need);
+    in.erase(in.begin(), in.begin() + need);
+
+    size_t wsum = 0;
+    size_t rsum = 0;
+    for (auto& seg : segs)
+    {
+        if (seg.flags & I2C_SEG_READ)
+            rsum += seg.len;
+        else
+            wsum += seg.len;
+    }
+
+    if (wsum != hdr.wlen || rsum > (size_t)I2C_BROKER_MAXDATA)
+    {
+        this->Reply(*client, hdr.id, I2C_ERR_REQUEST, nullptr, 0);
+        return 1;
+    }
+
+    auto it = buses.find(hdr.bus);
+    if (it == buses.end())
+    {
+        this->Reply(*client, hdr.id, I2C_ERR_BUS, nullptr, 0);
+        return 1;
+    }
+
+    Bus* b = &it->second;
+
+    req->rdata.resize(rsum);
+
+    size_t wpos = 0;
+    size_t rpos = 0;
+    for (auto& seg : segs)
+    {
+        if (seg.flags & I2C_SEG_READ)
+        {
+            req->batch.Read(req->rdata.data() + rpos, seg.len, seg.addr);
+            rpos += seg.len;
+        }
+        else
+        {
+            req->batch.Write(req->wdata.data() + wpos, seg.len, seg.addr);
+            wpos += seg.len;
+        }
+    }
+
+    {
+        lock_guard<mutex> lck(smtx);
+        b->stats.requests++;
+    }
+
+    try
+    {
+        b->queue->Submit(req->batch, [this, b, req] (exception_ptr exc)
+        {
+            {
+                lock_guard<mutex> lck(smtx);
+                if (exc)
+                {
+                    b->stats.failures++;
+                }
+                else
+                {
+                    b->stats.segments += req->hdr.nsegs;
+                    b->stats.bytes    += req->wdata.size() + req->rdata.size();
+                }
+            }
+
+            if (exc)
+                this->Reply(*req->client, req->hdr.id, I2C_ERR_XFER, nullptr, 0);
+            else
+                this->Reply(*req->client, req->hdr.id, I2C_OK, req->rdata.data(), req->rdata.size());
+        });
+    }
+    catch (I2CException&)
+    {
+        {
+            lock_guard<mutex> lck(smtx);
+            b->stats.failures++;
+        }
+        this->Reply(*client, hdr.id, I2C_ERR_BUSY, nullptr, 0);
+    }
+
+    return 1;
+}
+
+/*
+ * void I2CBroker::Reply(Client& client, uint32_t id, int32_t status, const uint8_t* data, uint32_t len)
+ *
+ * Description:
+ *   Sends a reply to a client. Called from the serving thread and
+ *   from the bus queue workers.
+ *
+ *   The send never blocks: a client that has stopped reading its
+ *   replies is shut down, rather than being allowed to stall a
+ *   bus queue, and Run() drops it.
+ *
+ * Parameters:
+ *   client - the client
+ *   id     - the request id
+ *   status - an I2CBrokerStatus
+ *   data   - read data, or null
+ *   len    - the number of bytes in data
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBroker::Reply(Client& client, uint32_t id, int32_t status, const uint8_t* data, uint32_t len)
+{
+    I2CRepHeader    rep;
+    vector<uint8_t> out(sizeof(rep) + len);
+
+    rep.id     = id;
+    rep.status = status;
+    rep.rlen   = len;
+
+    memcpy(out.data(), &rep, sizeof(rep));
+    if (len > 0)
+        memcpy(out.data() + sizeof(rep), data, len);
+
+    lock_guard<mutex> lck(client.wmtx);
+
+    if (client.fd < 0)
+        return;
+
+    size_t sent = 0;
+    while (sent < out.size())
+    {
+        ssize_t n = send(client.fd, out.data() + sent, out.size() - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            shutdown(client.fd, SHUT_RDWR);
+            return;
+        }
+        sent += n;
+    }
+}
+
+
+// I2CBroker Public
+// ------------------------------------------------------------------
+
+/*
+ * void I2CBroker::AddBus(uint8_t busno, shared_ptr<I2CBus> bus, size_t qdepth)
+ *
+ * Description:
+ *   Puts a bus under the broker's control, with a request queue
+ *   of its own. To be called before Run().
+ *
+ * Parameters:
+ *   busno  - the number clients use for the bus
+ *   bus    - the bus
+ *   qdepth - the most requests waiting on the bus. Defaults to 256.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBroker::AddBus(uint8_t busno, shared_ptr<I2CBus> bus, size_t qdepth)
+{
+    Bus& b = buses[busno];
+
+    b.queue.reset();
+    b.bus   = bus;
+    b.queue = make_shared<I2CQueue>(*bus, qdepth, true);
+    b.stats = I2CBrokerStats();
+}
+
+/*
+ * void I2CBroker::AddBus(uint8_t busno, const char* busfile)
+ *
+ * Description:
+ *   Puts the process's shared I2CBus for a bus file, from
+ *   I2CBus::Get(), under the broker's control. To be called
+ *   before Run().
+ *
+ * Parameters:
+ *   busno   - the number clients use for the bus
+ *   busfile - the bus file, such as "/dev/i2c-2"
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBroker::AddBus(uint8_t busno, const char* busfile)
+{
+    this->AddBus(busno, I2CBus::Get(busfile));
+}
+
+/*
+ * void I2CBroker::Run()
+ *
+ * Description:
+ *   Accepts clients and reads their requests until Stop() is
+ *   called. Clients still connected at that point are dropped;
+ *   requests already queued are carried out by the destructor.
+ *
+ * Exceptions:
+ *   I2CException - poll() failed.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBroker::Run()
+{
+    map<int, shared_ptr<Client> > clients;
+    vector<struct pollfd>         pfds;
+
+    for (;;)
+    {
+        pfds.clear();
+        pfds.push_back({ stopfd[0], POLLIN, 0 });
+        pfds.push_back({ lfd,       POLLIN, 0 });
+        for (auto& entry : clients)
+            pfds.push_back({ entry.first, POLLIN, 0 });
+
+        if (poll(pfds.data(), pfds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            I2CException iexc("poll() failed.", "I2CBroker::Run()");
+            throw iexc;
+        }
+
+        if (pfds[0].revents != 0)
+        {
+            char c;
+            while (read(stopfd[0], &c, 1) > 0)
+            { }
+            break;
+        }
+
+        if (pfds[1].revents & POLLIN)
+        {
+            int fd = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0)
+            {
+                auto c = make_shared<Client>();
+                c->fd = fd;
+                clients[fd] = c;
+            }
+        }
+
+        for (size_t i = 2; i < pfds.size(); i++)
+        {
+            if (pfds[i].revents == 0)
+                continue;
+
+            shared_ptr<Client> c = clients[pfds[i].fd];
+            if (!this->Receive(c))
+            {
+                lock_guard<mutex> lck(c->wmtx);
+                close(c->fd);
+                clients.erase(c->fd);
+                c->fd = -1;
+            }
+        }
+    }
+
+    for (auto& entry : clients)
+    {
+        lock_guard<mutex> lck(entry.second->wmtx);
+        close(entry.second->fd);
+        entry.second->fd = -1;
+    }
+}
+
+/*
+ * void I2CBroker::Stop()
+ *
+ * Description:
+ *   Makes Run() return. Safe to call from a signal handler.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBroker::Stop()
+{
+    char c = 0;
+    if (write(stopfd[1], &c, 1) < 0)
+    { }
+}
+
+/*
+ * I2CBrokerStats I2CBroker::GetStats(uint8_t busno)
+ *
+ * Description:
+ *   Returns a copy of the request counters for a bus. The bus's
+ *   own transfer statistics come from I2CBus::GetStats().
+ *
+ * Parameters:
+ *   busno - the bus number
+ *
+ * Exceptions:
+ *   I2CException - no such bus.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+I2CBrokerStats I2CBroker::GetStats(uint8_t busno)
+{
+    lock_guard<mutex> lck(smtx);
+
+    auto it = buses.find(busno);
+    if (it == buses.end())
+    {
+        I2CException iexc("No such bus.", "I2CBroker::GetStats(busno)");
+        throw iexc;
+    }
+
+    return it->second.stats;
+}
+
+
+
+// I2CBrokerClient Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CBrokerClient::I2CBrokerClient(const char* sockpath)
+ *
+ * Description:
+ *   Constructor. Connects to a broker.
+ *
+ * Parameters:
+ *   sockpath - the broker's socket path
+ *
+ * Exceptions:
+ *   I2CException - the broker cannot be reached.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+I2CBrokerClient::I2CBrokerClient(const char* sockpath)
+{
+    struct sockaddr_un sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strncpy(sa.sun_path, sockpath, sizeof(sa.sun_path) - 1);
+
+    nextid = 1;
+    fd     = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0 || connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+
+        stringstream ss;
+        ss << "Unable to connect to I2C broker at " << sockpath;
+        I2CException iexc(ss.str(), "I2CBrokerClient::I2CBrokerClient(sockpath)");
+        throw iexc;
+    }
+}
+
+/*
+ * I2CBrokerClient::~I2CBrokerClient()
+ *
+ * Description:
+ *   Destructor. Disconnects from the broker.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+I2CBrokerClient::~I2CBrokerClient()
+{
+    close(fd);
+}
+
+
+// I2CBrokerClient Protected
+// ------------------------------------------------------------------
+
+/*
+ * void I2CBrokerClient::Send(const void* data, size_t len)
+ *
+ * Description:
+ *   Sends bytes to the broker.
+ *
+ * Parameters:
+ *   data - the bytes
+ *   len  - the number of bytes
+ *
+ * Exceptions:
+ *   I2CException - the connection failed.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBrokerClient::Send(const void* data, size_t len)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+
+    while (len > 0)
+    {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            I2CException iexc("Lost connection to I2C broker.", "I2CBrokerClient::Send(data, len)");
+            throw iexc;
+        }
+        p   += n;
+        len -= n;
+    }
+}
+
+/*
+ * void I2CBrokerClient::Receive(void* data, size_t len)
+ *
+ * Description:
+ *   Receives exactly len bytes from the broker.
+ *
+ * Parameters:
+ *   data - buffer to receive the bytes
+ *   len  - the number of bytes
+ *
+ * Exceptions:
+ *   I2CException - the connection failed.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBrokerClient::Receive(void* data, size_t len)
+{
+    uint8_t* p = static_cast<uint8_t*>(data);
+
+    while (len > 0)
+    {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            I2CException iexc("Lost connection to I2C broker.", "I2CBrokerClient::Receive(data, len)");
+            throw iexc;
+        }
+        p   += n;
+        len -= n;
+    }
+}
+
+
+// I2CBrokerClient Public
+// ------------------------------------------------------------------
+
+/*
+ * void I2CBrokerClient::Transfer(uint8_t busno, I2CBatch& batch)
+ *
+ * Description:
+ *   Has the broker carry out a batch as one I2CBus::Transfer, and
+ *   waits for it. Read segments receive their data as they would
+ *   from I2CBus::Transfer.
+ *
+ * Parameters:
+ *   busno - the broker's number for the bus
+ *   batch - the segments to be transferred, at most
+ *           I2C_BROKER_MAXSEGS of them and I2C_BROKER_MAXDATA
+ *           bytes each way
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBrokerClient::Transfer(uint8_t busno, I2CBatch& batch)
+{
+    vector<struct i2c_msg>& msgs = batch.msgs;
+
+    size_t wlen = 0;
+    size_t rlen = 0;
+    for (auto& m : msgs)
+    {
+        if (m.flags & I2C_M_RD)
+            rlen += m.len;
+        else
+            wlen += m.len;
+    }
+
+    if ( msgs.empty() || msgs.size() > (size_t)I2C_BROKER_MAXSEGS ||
+         wlen > (size_t)I2C_BROKER_MAXDATA || rlen > (size_t)I2C_BROKER_MAXDATA )
+    {
+        I2CException iexc("Batch too large for the I2C broker.", "I2CBrokerClient::Transfer(busno, batch)");
+        throw iexc;
+    }
+
+    I2CReqHeader    hdr;
+    vector<uint8_t> out(sizeof(hdr) + msgs.size() * sizeof(I2CSegment) + wlen);
+    size_t          pos = sizeof(hdr);
+
+    for (auto& m : msgs)
+    {
+        I2CSegment seg;
+
+        seg.addr  = m.addr;
+        seg.pad   = 0;
+        seg.flags = (m.flags & I2C_M_RD) ? I2C_SEG_READ : 0;
+        seg.len   = m.len;
+
+        memcpy(out.data() + pos, &seg, sizeof(seg));
+        pos += sizeof(seg);
+    }
+    for (auto& m : msgs)
+    {
+        if (!(m.flags & I2C_M_RD) && m.len > 0)
+        {
+            memcpy(out.data() + pos, m.buf, m.len);
+            pos += m.len;
+        }
+    }
+
+    lock_guard<mutex> lck(mtx);
+
+    hdr.id    = nextid++;
+    hdr.bus   = busno;
+    hdr.nsegs = msgs.size();
+    hdr.wlen  = wlen;
+    memcpy(out.data(), &hdr, sizeof(hdr));
+
+    this->Send(out.data(), out.size());
+
+    I2CRepHeader rep;
+    this->Receive(&rep, sizeof(rep));
+
+    vector<uint8_t> in(rep.rlen);
+    if (rep.rlen > 0)
+        this->Receive(in.data(), rep.rlen);
+
+    if (rep.id != hdr.id)
+    {
+        I2CException iexc("Reply out of sequence from I2C broker.", "I2CBrokerClient::Transfer(busno, batch)");
+        throw iexc;
+    }
+
+    if (rep.status != I2C_OK)
+    {
+        const char* why = "Transfer error.";
+        if (rep.status == I2C_ERR_REQUEST)
+            why = "Request rejected by I2C broker.";
+        else if (rep.status == I2C_ERR_BUS)
+            why = "No such bus at I2C broker.";
+        else if (rep.status == I2C_ERR_BUSY)
+            why = "I2C broker queue full.";
+
+        I2CException iexc(why, "I2CBrokerClient::Transfer(busno, batch)");
+        throw iexc;
+    }
+
+    if (rep.rlen != rlen)
+    {
+        I2CException iexc("Short reply from I2C broker.", "I2CBrokerClient::Transfer(busno, batch)");
+        throw iexc;
+    }
+
+    pos = 0;
+    for (auto& m : msgs)
+    {
+        if ((m.flags & I2C_M_RD) && m.len > 0)
+        {
+            memcpy(m.buf, in.data() + pos, m.len);
+            pos += m.len;
+        }
+    }
+}
+
+/*
+ * void I2CBrokerClient::Read(uint8_t busno, uint8_t* data, int len, uint8_t i2caddr)
+ *
+ * Description:
+ *   Reads from a device through the broker.
+ *
+ * Parameters:
+ *   busno   - the broker's number for the bus
+ *   data    - a data buffer that will receive the bytes read
+ *   len     - the number of bytes to read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBrokerClient::Read(uint8_t busno, uint8_t* data, int len, uint8_t i2caddr)
+{
+    I2CBatch batch;
+
+    batch.Read(data, len, i2caddr);
+    this->Transfer(busno, batch);
+}
+
+/*
+ * void I2CBrokerClient::Write(uint8_t busno, uint8_t* data, int len, uint8_t i2caddr)
+ *
+ * Description:
+ *   Writes to a device through the broker.
+ *
+ * Parameters:
+ *   busno   - the broker's number for the bus
+ *   data    - the bytes to be written
+ *   len     - the number of bytes to write
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBrokerClient::Write(uint8_t busno, uint8_t* data, int len, uint8_t i2caddr)
+{
+    I2CBatch batch;
+
+    batch.Write(data, len, i2caddr);
+    this->Transfer(busno, batch);
+}
+
+/*
+ * void I2CBrokerClient::Xfer(uint8_t busno, uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ *
+ * Description:
+ *   Write, repeated START, read, through the broker, as with
+ *   I2CBus::Xfer.
+ *
+ * Parameters:
+ *   busno   - the broker's number for the bus
+ *   odat    - data buffer that contains the data to be written
+ *   olen    - the number of bytes to be written
+ *   idat    - buffer that will receive data read from the device
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+void I2CBrokerClient::Xfer(uint8_t busno, uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+{
+    I2CBatch batch;
+
+    batch.Xfer(odat, olen, idat, ilen, i2caddr);
+    this->Transfer(busno, batch);
+}
+
+} // namespace bbbi2c
@@ -0,0 +1,242 @@
+/*
+ * bbb-i2c-broker.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    I2C broker and client header. A broker owns the buses of the
+ *    board and serves transfer requests from other processes over
+ *    a Unix domain socket.
+ */
+
+#ifndef BBB_I2C_BROKER_HPP_
+#define BBB_I2C_BROKER_HPP_
+
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "bbb-i2c.hpp"
+#include "bbb-i2c-queue.hpp"
+
+
+namespace bbbi2c
+{
+
+/*
+ * Broker Protocol
+ *
+ *   All integers are in host byte order; client and broker run on
+ *   the same board.
+ *
+ *   Request:
+ *     I2CReqHeader
+ *     I2CSegment[nsegs]
+ *     the data of every write segment, in segment order
+ *
+ *   Reply:
+ *     I2CRepHeader
+ *     the data of every read segment, in segment order, if the
+ *     status is I2C_OK
+ *
+ *   The segments of one request are carried out as one
+ *   I2CBus::Transfer. A client may send further requests without
+ *   waiting for replies; replies carry the request id and come
+ *   back in request order for each bus.
+ */
+
+const int      I2C_BROKER_MAXSEGS = 42;      // Segments per request.
+const int      I2C_BROKER_MAXDATA = 8192;    // Data bytes per request.
+
+const uint16_t I2C_SEG_READ       = 0x0001;  // Segment reads from the device.
+
+enum I2CBrokerStatus
+{
+    I2C_OK          = 0,         // Transfer carried out.
+    I2C_ERR_XFER    = 1,         // Transfer failed.
+    I2C_ERR_REQUEST = 2,         // Malformed request.
+    I2C_ERR_BUS     = 3,         // No such bus.
+    I2C_ERR_BUSY    = 4          // Bus queue full.
+};
+
+struct I2CReqHeader
+{
+    uint32_t  id;                // Chosen by the client, echoed in the reply.
+    uint8_t   bus;               // Bus number.
+    uint8_t   nsegs;             // Number of segments.
+    uint16_t  wlen;              // Total write data bytes.
+};
+
+struct I2CSegment
+{
+    uint8_t   addr;              // Device address.
+    uint8_t   pad;
+    uint16_t  flags;             // I2C_SEG_READ, or 0 for a write.
+    uint16_t  len;               // Data bytes.
+};
+
+struct I2CRepHeader
+{
+    uint32_t  id;                // Request id.
+    int32_t   status;            // I2CBrokerStatus.
+    uint32_t  rlen;              // Read data bytes that follow.
+};
+
+
+/*
+ * struct I2CBrokerStats
+ *
+ * Description:
+ *   Running counters kept by an I2CBroker for one bus, alongside
+ *   the bus's own I2CStats.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+struct I2CBrokerStats
+{
+    unsigned long requests;      // Requests received.
+    unsigned long failures;      // Requests not carried out.
+    unsigned long segments;      // Segments carried out.
+    unsigned long bytes;         // Data bytes moved.
+};
+
+
+/*
+ * class I2CBroker
+ *
+ * Description:
+ *   Serves I2C transfer requests from other processes.
+ *
+ *   The broker owns one I2CBus, kept open, and one I2CQueue per
+ *   bus number. Requests arrive on a Unix domain socket. Each is
+ *   checked and placed on its bus's queue without waiting for
+ *   earlier requests to finish, and the queue worker merges the
+ *   requests waiting at each turn into as few I2C_RDWR ioctls as
+ *   possible. Replies are sent from the queue worker as each
+ *   request completes.
+ *
+ *   Requests for one bus are carried out in the order they were
+ *   received, whatever client they came from. Requests from
+ *   different clients may share an ioctl, but a failed merged
+ *   ioctl is retried one request at a time (see I2CQueue), so a
+ *   client that addresses an absent device fails only its own
+ *   requests.
+ *
+ *   Run() serves until Stop() is called, which may be done from a
+ *   signal handler.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+class I2CBroker
+{
+  protected:
+    struct Client
+    {
+        int                   fd;       // Connected socket.
+        std::vector<uint8_t>  in;       // Bytes received, not yet parsed.
+        std::mutex            wmtx;     // Serializes replies.
+    };
+
+    struct Request
+    {
+        std::shared_ptr<Client>  client;   // Where the reply goes.
+        I2CReqHeader             hdr;      // Request header.
+        std::vector<uint8_t>     wdata;    // Write data.
+        std::vector<uint8_t>     rdata;    // Read data.
+        I2CBatch                 batch;    // Segments, pointing into wdata and rdata.
+    };
+
+    struct Bus
+    {
+        std::shared_ptr<I2CBus>    bus;     // The bus.
+        std::shared_ptr<I2CQueue>  queue;   // Its request queue.
+        I2CBrokerStats             stats;   // Request counters.
+    };
+
+    string                   path;      // Socket path.
+    int                      lfd;       // Listening socket.
+    int                      stopfd[2]; // Stop() pipe.
+    std::map<uint8_t, Bus>   buses;     // Buses, by number.
+    std::mutex               smtx;      // Guards Bus::stats.
+
+    bool Receive ( std::shared_ptr<Client> client );
+    int  Parse   ( std::shared_ptr<Client> client );
+    void Reply   ( Client& client, uint32_t id, int32_t status,
+                   const uint8_t* data, uint32_t len );
+
+  public:
+    I2CBroker ( const char* sockpath, int mode = 0600 );
+   ~I2CBroker ();
+
+    I2CBroker ( const I2CBroker& ) = delete;
+    I2CBroker& operator= ( const I2CBroker& ) = delete;
+
+    void AddBus ( uint8_t busno, std::shared_ptr<I2CBus> bus, size_t qdepth = 256 );
+    void AddBus ( uint8_t busno, const char* busfile );
+
+    void Run  ();
+    void Stop ();
+
+    I2CBrokerStats GetStats ( uint8_t busno );
+
+}; // class I2CBroker
+
+
+/*
+ * class I2CBrokerClient
+ *
+ * Description:
+ *   A connection to an I2CBroker. Transfer() takes the same
+ *   I2CBatch a process would give to I2CBus::Transfer, sends it
+ *   to the broker as one request, and waits for the reply.
+ *
+ *   A client may be shared between threads; requests from
+ *   different threads are carried out in turn.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-broker.hpp
+ */
+class I2CBrokerClient
+{
+  protected:
+    int          fd;            // Connected socket.
+    uint32_t     nextid;        // Id for the next request.
+    std::mutex   mtx;           // One request at a time.
+
+    void Send    ( const void* data, size_t len );
+    void Receive ( void* data, size_t len );
+
+  public:
+    I2CBrokerClient ( const char* sockpath );
+   ~I2CBrokerClient ();
+
+    I2CBrokerClient ( const I2CBrokerClient& ) = delete;
+    I2CBrokerClient& operator= ( const I2CBrokerClient& ) = delete;
+
+    void Transfer ( uint8_t busno, I2CBatch& batch );
+
+    void Read  ( uint8_t busno, uint8_t* data, int len, uint8_t i2caddr );
+    void Write ( uint8_t busno, uint8_t* data, int len, uint8_t i2caddr );
+    void Xfer  ( uint8_t busno, uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
+
+}; // class I2CBrokerClient
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_BROKER_HPP_ */
@@ -0,0 +1,378 @@
+/*
+ * bbb-i2c-coalesce.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements I2C register write coalescing.
+ */
+
+
+#include "bbb-i2c-coalesce.hpp"
+
+#include <chrono>             // steady_clock, microseconds
+#include <condition_variable> // condition_variable
+#include <exception>          // exception_ptr, current_exception, rethrow_exception
+#include <mutex>              // mutex, unique_lock, lock_guard
+#include <stdint.h>           // uint8_t
+#include <string.h>           // memcpy
+#include <thread>             // thread
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+// I2CWriteCoalescer Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CWriteCoalescer::I2CWriteCoalescer(I2CBus& i2cbus, chrono::microseconds win)
+ *
+ * Description:
+ *   Constructor. Starts the flush thread. No device is enabled,
+ *   so until Enable() is called every write passes straight
+ *   through.
+ *
+ * Parameters:
+ *   i2cbus - the bus to be written
+ *   win    - the coalescing window. Defaults to 1 ms.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+I2CWriteCoalescer::I2CWriteCoalescer(I2CBus& i2cbus, chrono::microseconds win)
+    : bus(i2cbus)
+{
+    window   = win;
+    pending  = false;
+    stopping = false;
+    flusher  = thread(&I2CWriteCoalescer::Run, this);
+}
+
+/*
+ * I2CWriteCoalescer::~I2CWriteCoalescer()
+ *
+ * Description:
+ *   Destructor. Flushes held values and stops the flush thread.
+ *   A flush error at this point is discarded.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+I2CWriteCoalescer::~I2CWriteCoalescer()
+{
+    {
+        lock_guard<mutex> lck(mtx);
+
+        stopping = true;
+        try
+        {
+            this->FlushHeld();
+        }
+        catch (...)
+        { }
+    }
+    cv.notify_one();
+    flusher.join();
+}
+
+
+// I2CWriteCoalescer Protected
+// ------------------------------------------------------------------
+
+/*
+ * void I2CWriteCoalescer::FlushHeld()
+ *
+ * Description:
+ *   Writes every held value in one Transfer: one burst write per
+ *   held run, in the order the runs were begun, split at the
+ *   device's maximum burst length. The held values are released
+ *   whether or not the transfer succeeds.
+ *
+ *   Assumes that the coalescer mutex is held.
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+void I2CWriteCoalescer::FlushHeld()
+{
+    if (!pending)
+        return;
+
+    pending = false;
+
+    // Every held value needs a byte, and every burst a register
+    // byte. Size the buffer once so that batch pointers stay put.
+    size_t need = 0;
+    for (uint8_t addr : order)
+        need += 2 * devices[addr].count;
+    if (buf.size() < need)
+        buf.resize(need);
+
+    I2CBatch batch;
+    size_t   pos = 0;
+
+    for (uint8_t addr : order)
+    {
+        Device& dev = devices[addr];
+
+        for (int done = 0; done < dev.count; )
+        {
+            int len = dev.count - done;
+            if (len > dev.maxburst)
+                len = dev.maxburst;
+
+            buf[pos] = dev.first + done;
+            memcpy(&buf[pos + 1], &dev.vals[done], len);
+            batch.Write(&buf[pos], len + 1, addr);
+
+            pos  += len + 1;
+            done += len;
+        }
+
+        dev.count = 0;
+    }
+    order.clear();
+
+    bus.Transfer(batch);
+}
+
+/*
+ * void I2CWriteCoalescer::Rethrow()
+ *
+ * Description:
+ *   Rethrows, once, an exception left by a background flush.
+ *
+ *   Assumes that the coalescer mutex is held.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+void I2CWriteCoalescer::Rethrow()
+{
+    if (failure)
+    {
+        exception_ptr exc = failure;
+        failure = nullptr;
+        rethrow_exception(exc);
+    }
+}
+
+/*
+ * void I2CWriteCoalescer::Settle()
+ *
+ * Description:
+ *   Flushes the held values ahead of a write that cannot join
+ *   them. A flush error is kept, like a background one, so that
+ *   the write can still be made before the error is reported.
+ *
+ *   Assumes that the coalescer mutex is held.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+void I2CWriteCoalescer::Settle()
+{
+    try
+    {
+        this->FlushHeld();
+    }
+    catch (...)
+    {
+        failure = current_exception();
+    }
+}
+
+/*
+ * void I2CWriteCoalescer::Run()
+ *
+ * Description:
+ *   Flush thread. Sleeps until a window opens, then until it
+ *   closes, and flushes.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+void I2CWriteCoalescer::Run()
+{
+    unique_lock<mutex> lck(mtx);
+
+    while (!stopping)
+    {
+        if (!pending)
+        {
+            cv.wait(lck);
+            continue;
+        }
+
+        if (chrono::steady_clock::now() < deadline)
+        {
+            cv.wait_until(lck, deadline);
+            continue;
+        }
+
+        try
+        {
+            this->FlushHeld();
+        }
+        catch (...)
+        {
+            failure = current_exception();
+        }
+    }
+}
+
+
+
+// I2CWriteCoalescer Public
+// ------------------------------------------------------------------
+
+/*
+ * void I2CWriteCoalescer::Enable(uint8_t i2caddr, int maxburst)
+ *
+ * Description:
+ *   Enables coalescing for a device. The device must auto-increment
+ *   its register address on multi-byte writes.
+ *
+ * Parameters:
+ *   i2caddr  - I2C address of the device
+ *   maxburst - the most registers to write in one burst. Defaults
+ *              to 32.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+void I2CWriteCoalescer::Enable(uint8_t i2caddr, int maxburst)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (devices.count(i2caddr) != 0)
+        return;
+
+    Device& dev = devices[i2caddr];
+
+    dev.maxburst = (maxburst < 1) ? 1 : maxburst;
+    dev.first    = 0;
+    dev.count    = 0;
+}
+
+/*
+ * void I2CWriteCoalescer::Write(uint8_t* data, int len, uint8_t i2caddr)
+ *
+ * Description:
+ *   Writes one or more consecutive registers. For an enabled device,
+ *   the values are held and written at the end of the current
+ *   coalescing window, or sooner if a later write does not extend
+ *   the held run. Otherwise they are written at once.
+ *
+ *   If an earlier flush failed, its exception is thrown here, but
+ *   only after this write has been held or written.
+ *
+ * Parameters:
+ *   data    - register address followed by register values
+ *   len     - the number of bytes in data
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+void I2CWriteCoalescer::Write(uint8_t* data, int len, uint8_t i2caddr)
+{
+    lock_guard<mutex> lck(mtx);
+
+    auto it = devices.find(i2caddr);
+    if (it == devices.end() || len < 2 || data[0] + len - 1 > 256)
+    {
+        this->Settle();
+        bus.Write(data, len, i2caddr);
+        this->Rethrow();
+        return;
+    }
+
+    Device& dev = it->second;
+
+    bool extends = dev.count > 0 && order.back() == i2caddr &&
+                   data[0] == dev.first + dev.count;
+
+    if (!extends && dev.count > 0)
+        this->Settle();
+
+    if (dev.count == 0)
+    {
+        dev.first = data[0];
+        order.push_back(i2caddr);
+    }
+
+    memcpy(&dev.vals[dev.count], &data[1], len - 1);
+    dev.count += len - 1;
+
+    if (!pending)
+    {
+        pending  = true;
+        deadline = chrono::steady_clock::now() + window;
+        cv.notify_one();
+    }
+
+    this->Rethrow();
+}
+
+/*
+ * void I2CWriteCoalescer::Flush()
+ *
+ * Description:
+ *   Writes all held values now, without waiting for the window to
+ *   close. Call before reading back registers that may be held.
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+void I2CWriteCoalescer::Flush()
+{
+    lock_guard<mutex> lck(mtx);
+
+    this->Rethrow();
+    this->FlushHeld();
+}
+
+} // namespace bbbi2c
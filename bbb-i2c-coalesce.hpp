@@ -0,0 +1,115 @@
+/*
+ * bbb-i2c-coalesce.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    I2C register write coalescing header.
+ */
+
+#ifndef BBB_I2C_COALESCE_HPP_
+#define BBB_I2C_COALESCE_HPP_
+
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "bbb-i2c.hpp"
+
+
+namespace bbbi2c
+{
+
+/*
+ * class I2CWriteCoalescer
+ *
+ * Description:
+ *   Merges sequential writes to consecutive registers of a device
+ *   into auto-increment burst writes.
+ *
+ *   Write() takes the same arguments as I2CBus::Write(): the first
+ *   byte of data is the register address and the rest are register
+ *   values. For devices enabled with Enable(), the values are held
+ *   for up to one coalescing window. At the end of the window, all
+ *   held values go out in one I2CBus::Transfer, each held run as a
+ *   single burst write, in the order the runs were begun.
+ *
+ *   A write extends the last held run only if it is to the same
+ *   device and starts at the register just past the end of the
+ *   run. A write that would go back to a register of a device that
+ *   already has a held run, or skip ahead, flushes the held values
+ *   first. Writes are therefore never reordered or collapsed, and
+ *   ordered sequences such as a PCA9685 sleep, prescale, wake on
+ *   MODE1 reach the device intact.
+ *
+ *   Writes to devices that have not been enabled, and writes with
+ *   no register value, are passed straight to the bus after the
+ *   held values have been flushed, so the bus still sees writes
+ *   in order.
+ *
+ *   A flush at the end of a window runs on a background thread.
+ *   If it fails, the exception is rethrown by the next call to
+ *   Write() or Flush(), after that call's own write has been held
+ *   or carried out.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-coalesce.hpp
+ */
+class I2CWriteCoalescer
+{
+  protected:
+    struct Device
+    {
+        int      maxburst;       // Most registers per burst write.
+        int      first;          // First register of the held run.
+        int      count;          // Registers in the held run, 0 if none.
+        uint8_t  vals[256];      // Held register values, from first.
+    };
+
+    I2CBus&                    bus;        // The bus being written.
+    std::chrono::microseconds  window;     // Coalescing window.
+    std::map<uint8_t, Device>  devices;    // Enabled devices, by address.
+    std::vector<uint8_t>       order;      // Devices with held runs, in order begun.
+    std::vector<uint8_t>       buf;        // Burst write buffer.
+    std::exception_ptr         failure;    // Background flush error.
+    bool                       pending;    // Some device has held values.
+    bool                       stopping;   // Flusher is to exit.
+    std::chrono::steady_clock::time_point deadline;  // End of the current window.
+
+    std::mutex                 mtx;        // Guards everything above.
+    std::condition_variable    cv;         // Signals the flusher.
+    std::thread                flusher;    // Window flush thread.
+
+    void FlushHeld ();
+    void Rethrow   ();
+    void Settle    ();
+    void Run       ();
+
+  public:
+    I2CWriteCoalescer ( I2CBus& i2cbus,
+                        std::chrono::microseconds win = std::chrono::microseconds(1000) );
+   ~I2CWriteCoalescer ();
+
+    I2CWriteCoalescer ( const I2CWriteCoalescer& ) = delete;
+    I2CWriteCoalescer& operator= ( const I2CWriteCoalescer& ) = delete;
+
+    void Enable ( uint8_t i2caddr, int maxburst = 32 );
+
+    void Write ( uint8_t* data, int len, uint8_t i2caddr );
+    void Flush ();
+
+}; // class I2CWriteCoalescer
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_COALESCE_HPP_ */
@@ -0,0 +1,477 @@
+/*
+ * bbb-i2c-queue.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements the asynchronous I2C submission queue.
+ */
+
+
+#include "bbb-i2c-queue.hpp"
+
+#include <chrono>             // steady_clock, microseconds
+#include <condition_variable> // condition_variable
+#include <deque>              // deque
+#include <exception>          // exception_ptr, current_exception
+#include <future>             // future, promise
+#include <linux/i2c-dev.h>    // I2C_RDWR_IOCTL_MAX_MSGS
+#include <map>                // multimap
+#include <memory>             // shared_ptr, make_shared
+#include <mutex>              // mutex, lock_guard, unique_lock
+#include <thread>             // thread
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+// I2CQueue Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CQueue::I2CQueue(I2CBus& i2cbus, size_t qdepth, bool mergebatches)
+ *
+ * Description:
+ *   Constructor. Starts the bus worker thread.
+ *
+ * Parameters:
+ *   i2cbus       - the bus to be served
+ *   qdepth       - the maximum number of waiting batches.
+ *                  Defaults to 64.
+ *   mergebatches - true to let the worker merge waiting batches
+ *                  into one ioctl. Defaults to true.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+I2CQueue::I2CQueue(I2CBus& i2cbus, size_t qdepth, bool mergebatches)
+    : bus(i2cbus)
+{
+    depth    = qdepth;
+    merge    = mergebatches;
+    stopping = false;
+    worker   = thread(&I2CQueue::Run, this);
+}
+
+/*
+ * I2CQueue::~I2CQueue()
+ *
+ * Description:
+ *   Destructor. Lets the worker finish whatever is still queued,
+ *   including delayed reads, then stops it.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+I2CQueue::~I2CQueue()
+{
+    {
+        lock_guard<mutex> lck(qmtx);
+        stopping = true;
+    }
+    qcv.notify_one();
+    worker.join();
+}
+
+
+// I2CQueue Protected
+// ------------------------------------------------------------------
+
+/*
+ * void I2CQueue::Enqueue(const Request& req)
+ *
+ * Description:
+ *   Adds a request to the queue and wakes the worker.
+ *
+ * Parameters:
+ *   req - the request
+ *
+ * Exceptions:
+ *   I2CException - the queue is full.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+void I2CQueue::Enqueue(const Request& req)
+{
+    {
+        lock_guard<mutex> lck(qmtx);
+
+        if (queue.size() >= depth)
+        {
+            I2CException iexc("Submission queue full.", "I2CQueue::Submit(batch)");
+            throw iexc;
+        }
+
+        queue.push_back(req);
+    }
+    qcv.notify_one();
+}
+
+/*
+ * void I2CQueue::Promote()
+ *
+ * Description:
+ *   Moves delayed requests that have fallen due onto the queue.
+ *   They are not subject to the queue depth, since their trigger
+ *   batches already were.
+ *
+ *   Assumes that the queue mutex is held.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+void I2CQueue::Promote()
+{
+    auto now = chrono::steady_clock::now();
+
+    while (!timed.empty() && timed.begin()->first <= now)
+    {
+        queue.push_back(timed.begin()->second);
+        timed.erase(timed.begin());
+    }
+}
+
+/*
+ * void I2CQueue::Run()
+ *
+ * Description:
+ *   Worker thread. Takes the request at the head of the queue,
+ *   along with as many following requests as fit into a single
+ *   I2C_RDWR ioctl, and carries them out as one transfer. Only
+ *   replayable requests are merged. If a merged transfer fails,
+ *   its requests are carried out again one at a time, so that a
+ *   device that is absent fails only the requests addressed to it.
+ *
+ *   While the queue is empty, sleeps until a request is queued or
+ *   a delayed request falls due.
+ *
+ *   Exits when the queue is empty, no delayed requests remain,
+ *   and the destructor has asked it to stop.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+void I2CQueue::Run()
+{
+    deque<Request> group;
+    I2CBatch       merged;
+
+    unique_lock<mutex> lck(qmtx);
+
+    for (;;)
+    {
+        this->Promote();
+
+        if (queue.empty())
+        {
+            if (timed.empty())
+            {
+                if (stopping)
+                    return;
+                qcv.wait(lck);
+            }
+            else
+            {
+                qcv.wait_until(lck, timed.begin()->first);
+            }
+            continue;
+        }
+
+        int nmsgs = queue.front().batch->Size();
+        group.push_back(queue.front());
+        queue.pop_front();
+
+        while ( merge && !queue.empty() &&
+                group.front().batch->Replayable() &&
+                queue.front().batch->Replayable() &&
+                nmsgs + queue.front().batch->Size() <= I2C_RDWR_IOCTL_MAX_MSGS )
+        {
+            nmsgs += queue.front().batch->Size();
+            group.push_back(queue.front());
+            queue.pop_front();
+        }
+
+        lck.unlock();
+
+        exception_ptr exc;
+        try
+        {
+            if (group.size() == 1)
+            {
+                bus.Transfer(*group.front().batch);
+            }
+            else
+            {
+                merged.Clear();
+                for (auto& req : group)
+                    merged.Append(*req.batch);
+                bus.Transfer(merged);
+            }
+        }
+        catch (...)
+        {
+            exc = current_exception();
+        }
+
+        if (exc && group.size() > 1)
+        {
+            for (auto& req : group)
+            {
+                exception_ptr rexc;
+                try
+                {
+                    bus.Transfer(*req.batch);
+                }
+                catch (...)
+                {
+                    rexc = current_exception();
+                }
+
+                this->Complete(req, rexc);
+            }
+        }
+        else
+        {
+            for (auto& req : group)
+                this->Complete(req, exc);
+        }
+        group.clear();
+
+        lck.lock();
+    }
+}
+
+/*
+ * void I2CQueue::Complete(Request& req, exception_ptr exc)
+ *
+ * Description:
+ *   Reports completion to a request. An exception thrown by the
+ *   callback is discarded, so that it cannot take down the worker.
+ *
+ * Parameters:
+ *   req - the completed request
+ *   exc - the transfer exception, or null on success
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+void I2CQueue::Complete(Request& req, exception_ptr exc)
+{
+    try
+    {
+        req.done(exc);
+    }
+    catch (...)
+    { }
+}
+
+
+// I2CQueue Public
+// ------------------------------------------------------------------
+
+/*
+ * future<void> I2CQueue::Submit(I2CBatch& batch)
+ *
+ * Description:
+ *   Queues a batch and returns a future that becomes ready when
+ *   the batch has been carried out. A transfer error is delivered
+ *   through the future.
+ *
+ * Parameters:
+ *   batch - the segments to be transferred. Must stay valid until
+ *           the future is ready.
+ *
+ * Exceptions:
+ *   I2CException - the queue is full.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+future<void> I2CQueue::Submit(I2CBatch& batch)
+{
+    auto prom = make_shared< promise<void> >();
+
+    this->Submit(batch, [prom] (exception_ptr exc)
+    {
+        if (exc)
+            prom->set_exception(exc);
+        else
+            prom->set_value();
+    });
+
+    return prom->get_future();
+}
+
+/*
+ * void I2CQueue::Submit(I2CBatch& batch, Callback done)
+ *
+ * Description:
+ *   Queues a batch. The callback is called on the worker thread
+ *   when the batch has been carried out, with a null exception_ptr
+ *   on success or the transfer exception on failure.
+ *
+ * Parameters:
+ *   batch - the segments to be transferred. Must stay valid until
+ *           the callback is called.
+ *   done  - the completion callback
+ *
+ * Exceptions:
+ *   I2CException - the queue is full.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+void I2CQueue::Submit(I2CBatch& batch, Callback done)
+{
+    Request req;
+
+    req.batch = &batch;
+    req.done  = done;
+
+    this->Enqueue(req);
+}
+
+/*
+ * future<void> I2CQueue::Measure(I2CBatch& trigger, chrono::microseconds delay, I2CBatch& read)
+ *
+ * Description:
+ *   Queues a trigger, wait, read sequence and returns a future that
+ *   becomes ready when the read has been carried out. An error in
+ *   either batch is delivered through the future.
+ *
+ * Parameters:
+ *   trigger - the segments that start a measurement
+ *   delay   - the conversion time, counted from the completion of
+ *             the trigger
+ *   read    - the segments that collect the result
+ *
+ *   Both batches must stay valid until the future is ready.
+ *
+ * Exceptions:
+ *   I2CException - the queue is full.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+future<void> I2CQueue::Measure(I2CBatch& trigger, chrono::microseconds delay, I2CBatch& read)
+{
+    auto prom = make_shared< promise<void> >();
+
+    this->Measure(trigger, delay, read, [prom] (exception_ptr exc)
+    {
+        if (exc)
+            prom->set_exception(exc);
+        else
+            prom->set_value();
+    });
+
+    return prom->get_future();
+}
+
+/*
+ * void I2CQueue::Measure(I2CBatch& trigger, chrono::microseconds delay, I2CBatch& read, Callback done)
+ *
+ * Description:
+ *   Queues a trigger, wait, read sequence. The trigger is queued
+ *   at once. When it completes, the read is set aside until the
+ *   delay has passed, then queued again; the bus is free for
+ *   other batches in between. The callback is called once, on the
+ *   worker thread, after the read, or after the trigger if the
+ *   trigger fails.
+ *
+ *   The queue does not keep other batches away from the device
+ *   during the delay. If another thread may also start
+ *   measurements on it, the caller must keep them apart.
+ *
+ * Parameters:
+ *   trigger - the segments that start a measurement
+ *   delay   - the conversion time, counted from the completion of
+ *             the trigger
+ *   read    - the segments that collect the result
+ *   done    - the completion callback
+ *
+ *   Both batches must stay valid until the callback is called.
+ *
+ * Exceptions:
+ *   I2CException - the queue is full.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+void I2CQueue::Measure(I2CBatch& trigger, chrono::microseconds delay, I2CBatch& read, Callback done)
+{
+    I2CBatch* rd = &read;
+
+    this->Submit(trigger, [this, delay, rd, done] (exception_ptr exc)
+    {
+        if (exc)
+        {
+            done(exc);
+            return;
+        }
+
+        Request req;
+
+        req.batch = rd;
+        req.done  = done;
+
+        lock_guard<mutex> lck(qmtx);
+        timed.insert(make_pair(chrono::steady_clock::now() + delay, req));
+    });
+}
+
+/*
+ * size_t I2CQueue::Pending()
+ *
+ * Description:
+ *   Returns the number of batches waiting for the worker, delayed
+ *   reads included. Batches that the worker is currently carrying
+ *   out are not counted.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+size_t I2CQueue::Pending()
+{
+    lock_guard<mutex> lck(qmtx);
+    return queue.size() + timed.size();
+}
+
+} // namespace bbbi2c
@@ -0,0 +1,116 @@
+/*
+ * bbb-i2c-queue.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Asynchronous I2C submission queue header.
+ */
+
+#ifndef BBB_I2C_QUEUE_HPP_
+#define BBB_I2C_QUEUE_HPP_
+
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+
+#include "bbb-i2c.hpp"
+
+
+namespace bbbi2c
+{
+
+/*
+ * class I2CQueue
+ *
+ * Description:
+ *   An asynchronous front end for an I2CBus.
+ *
+ *   Submit() places a batch on a bounded queue and returns at
+ *   once. A worker thread, one per queue, takes batches off the
+ *   queue and carries them out. When several batches are waiting,
+ *   the worker merges as many as fit into one I2C_RDWR ioctl.
+ *   Only replayable batches (see I2CBatch::Replayable()) are
+ *   merged; a batch that writes data goes out on its own.
+ *
+ *   Completion is reported through a std::future or a callback.
+ *   Callbacks run on the worker thread and should be short.
+ *
+ *   A batch and its buffers must stay valid until completion is
+ *   reported. If a merged transfer fails, the kernel does not say
+ *   which message failed, so the batches that took part in it are
+ *   carried out again one at a time, and each receives only its
+ *   own exception, if any.
+ *
+ *   Submit() never waits for the bus. If the queue is full it
+ *   throws an I2CException instead.
+ *
+ *   Measure() queues a trigger batch and a read batch, with a
+ *   conversion delay between them. The bus is free for other
+ *   batches during the delay; the read is queued again when it
+ *   falls due.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-queue.hpp
+ */
+class I2CQueue
+{
+  public:
+    typedef std::function<void (std::exception_ptr)> Callback;
+
+  protected:
+    struct Request
+    {
+        I2CBatch*  batch;        // Segments to be carried out.
+        Callback   done;         // Completion callback.
+    };
+
+    I2CBus&                  bus;        // The bus being served.
+    size_t                   depth;      // Queue capacity, in batches.
+    bool                     merge;      // Merge waiting batches into one ioctl.
+    bool                     stopping;   // Worker is to exit once the queue is empty.
+    std::deque<Request>      queue;      // Waiting requests.
+    std::multimap<std::chrono::steady_clock::time_point, Request> timed;  // Delayed requests, by due time.
+    std::mutex               qmtx;       // Guards queue, timed and stopping.
+    std::condition_variable  qcv;        // Signals the worker.
+    std::thread              worker;     // Bus worker thread.
+
+    void Enqueue  ( const Request& req );
+    void Promote  ();
+    void Run      ();
+    void Complete ( Request& req, std::exception_ptr exc );
+
+  public:
+    I2CQueue ( I2CBus& i2cbus, size_t qdepth = 64, bool mergebatches = true );
+   ~I2CQueue ();
+
+    I2CQueue ( const I2CQueue& ) = delete;
+    I2CQueue& operator= ( const I2CQueue& ) = delete;
+
+    std::future<void> Submit ( I2CBatch& batch );
+    void              Submit ( I2CBatch& batch, Callback done );
+
+    std::future<void> Measure ( I2CBatch& trigger, std::chrono::microseconds delay,
+                                I2CBatch& read );
+    void              Measure ( I2CBatch& trigger, std::chrono::microseconds delay,
+                                I2CBatch& read, Callback done );
+
+    size_t Pending ();
+
+}; // class I2CQueue
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_QUEUE_HPP_ */
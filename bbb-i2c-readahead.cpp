@@ -0,0 +1,220 @@
+/*
+ * bbb-i2c-readahead.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements the I2C register read-ahead cache.
+ */
+
+
+#include "bbb-i2c-readahead.hpp"
+
+#include <chrono>            // steady_clock, microseconds
+#include <mutex>             // mutex, lock_guard
+#include <stdint.h>          // uint8_t
+#include <string.h>          // memcpy
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+// I2CReadAhead Constructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CReadAhead::I2CReadAhead(I2CBus& i2cbus, uint8_t i2caddr, int blksize, chrono::microseconds life)
+ *
+ * Description:
+ *   Constructor. Binds the cache to a device. The cache starts
+ *   out empty.
+ *
+ * Parameters:
+ *   i2cbus  - the bus the device is attached to
+ *   i2caddr - I2C address of the device
+ *   blksize - the number of registers to fetch on a miss, 1 to 256.
+ *             Defaults to 16.
+ *   life    - how long a fetched block stays valid. Defaults
+ *             to 1 ms.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-readahead.hpp
+ */
+I2CReadAhead::I2CReadAhead(I2CBus& i2cbus, uint8_t i2caddr, int blksize, chrono::microseconds life)
+    : bus(i2cbus)
+{
+    addr      = i2caddr;
+    blocksize = blksize;
+    ttl       = life;
+    first     = 0;
+    count     = 0;
+
+    if (blocksize < 1)
+        blocksize = 1;
+    if (blocksize > 256)
+        blocksize = 256;
+}
+
+
+// I2CReadAhead Public
+// ------------------------------------------------------------------
+
+/*
+ * void I2CReadAhead::Read(uint8_t reg, uint8_t* data, int len)
+ *
+ * Description:
+ *   Reads consecutive registers. If they all lie in a block that
+ *   is still valid, they are copied from the block. Otherwise a
+ *   new block of blocksize registers (or len, if larger) starting
+ *   at reg is fetched in one Xfer, and the read is served from it.
+ *
+ * Parameters:
+ *   reg  - first register address
+ *   data - a buffer to receive register values
+ *   len  - the number of registers
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-readahead.hpp
+ */
+void I2CReadAhead::Read(uint8_t reg, uint8_t* data, int len)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (len < 1 || reg + len > 256)
+    {
+        I2CException iexc("Register range out of bounds.", "I2CReadAhead::Read(reg, data, len)");
+        throw iexc;
+    }
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    bool hit = count > 0 &&
+               reg >= first && reg + len <= first + count &&
+               now - fetched < ttl;
+
+    if (!hit)
+    {
+        int fetch = (len > blocksize) ? len : blocksize;
+        if (reg + fetch > 256)
+            fetch = 256 - reg;
+
+        count = 0;
+        bus.Xfer(&reg, 1, &block[reg], fetch, addr);
+
+        first   = reg;
+        count   = fetch;
+        fetched = now;
+    }
+
+    memcpy(data, &block[reg], len);
+}
+
+/*
+ * void I2CReadAhead::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen)
+ *
+ * Description:
+ *   Register read in I2CDevice::Xfer form: odat holds a single
+ *   register address. Served by Read(). Any other Xfer goes
+ *   straight to the bus and invalidates the block, since its
+ *   effect on the registers is unknown.
+ *
+ * Parameters:
+ *   odat - data buffer that contains the data to be written
+ *   olen - the number of bytes to be written
+ *   idat - buffer that will receive data read from the device
+ *   ilen - number of bytes to be read
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-readahead.hpp
+ */
+void I2CReadAhead::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen)
+{
+    if (olen == 1)
+    {
+        this->Read(odat[0], idat, ilen);
+        return;
+    }
+
+    this->Invalidate();
+    bus.Xfer(odat, olen, idat, ilen, addr);
+}
+
+/*
+ * void I2CReadAhead::Write(uint8_t* data, int len)
+ *
+ * Description:
+ *   Writes to the device: data[0] is the register address and the
+ *   remaining bytes are register values. If the write overlaps the
+ *   cached block, the block is invalidated.
+ *
+ * Parameters:
+ *   data - register address followed by register values
+ *   len  - the number of bytes in data
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-readahead.hpp
+ */
+void I2CReadAhead::Write(uint8_t* data, int len)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (len > 1 && count > 0)
+    {
+        int reg  = data[0];
+        int last = reg + len - 2;
+
+        if (reg < first + count && last >= first)
+            count = 0;
+    }
+
+    bus.Write(data, len, addr);
+}
+
+/*
+ * void I2CReadAhead::Invalidate()
+ *
+ * Description:
+ *   Discards the cached block, so that the next read goes to the
+ *   device. Call when the device may have changed registers in the
+ *   block, for instance after a data-ready interrupt.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-readahead.hpp
+ */
+void I2CReadAhead::Invalidate()
+{
+    lock_guard<mutex> lck(mtx);
+    count = 0;
+}
+
+} // namespace bbbi2c
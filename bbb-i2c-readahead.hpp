@@ -0,0 +1,81 @@
+/*
+ * bbb-i2c-readahead.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    I2C register read-ahead header.
+ */
+
+#ifndef BBB_I2C_READAHEAD_HPP_
+#define BBB_I2C_READAHEAD_HPP_
+
+
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+
+#include "bbb-i2c.hpp"
+
+
+namespace bbbi2c
+{
+
+/*
+ * class I2CReadAhead
+ *
+ * Description:
+ *   A read-ahead block cache for one device with eight-bit,
+ *   auto-incrementing register addresses.
+ *
+ *   A register read that misses the cache fetches a whole block,
+ *   starting at the requested register, in one repeated-start
+ *   Xfer. Reads that fall inside the block are then served from
+ *   it until it is older than the time-to-live, or until it is
+ *   invalidated. Writes made through the read-ahead object
+ *   invalidate the block if they overlap it.
+ *
+ *   Xfer() and Write() take the same arguments as the I2CDevice
+ *   functions of the same name, so a driver can switch over
+ *   without other changes. An Xfer whose write part is not a
+ *   single register address is passed straight to the bus.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-readahead.hpp
+ */
+class I2CReadAhead
+{
+  protected:
+    I2CBus&                    bus;        // The bus the device lives on.
+    uint8_t                    addr;       // Device address.
+    int                        blocksize;  // Registers fetched per miss.
+    std::chrono::microseconds  ttl;        // Block lifetime.
+    std::mutex                 mtx;        // Guards the block.
+
+    uint8_t                    block[256]; // Cached register values.
+    int                        first;      // First cached register.
+    int                        count;      // Cached registers, 0 if none.
+    std::chrono::steady_clock::time_point fetched;  // When the block was read.
+
+  public:
+    I2CReadAhead ( I2CBus& i2cbus, uint8_t i2caddr, int blksize = 16,
+                   std::chrono::microseconds life = std::chrono::microseconds(1000) );
+
+    I2CReadAhead ( const I2CReadAhead& ) = delete;
+    I2CReadAhead& operator= ( const I2CReadAhead& ) = delete;
+
+    void Read  ( uint8_t reg, uint8_t* data, int len );
+    void Xfer  ( uint8_t* odat, int olen, uint8_t* idat, int ilen );
+    void Write ( uint8_t* data, int len );
+
+    void Invalidate ();
+
+}; // class I2CReadAhead
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_READAHEAD_HPP_ */
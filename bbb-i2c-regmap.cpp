@@ -0,0 +1,613 @@
+/*
+ * bbb-i2c-regmap.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements the I2C register map cache.
+ */
+
+
+#include "bbb-i2c-regmap.hpp"
+
+#include <mutex>             // mutex, lock_guard
+#include <stdint.h>          // uint8_t
+#include <string.h>          // memcpy
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+// Longest run of clean registers that Flush() will rewrite in order
+// to join two dirty runs into one burst. A new burst costs a START,
+// an address byte, a register byte, and a STOP, about 20 SCL clocks;
+// rewriting a clean register costs 9.
+static const int MAX_BRIDGE = 2;
+
+
+// I2CRegMap Constructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CRegMap::I2CRegMap(I2CBus& i2cbus, uint8_t i2caddr)
+ *
+ * Description:
+ *   Constructor. Binds the map to a device. Every register starts
+ *   out volatile, with no cached value.
+ *
+ * Parameters:
+ *   i2cbus  - the bus the device is attached to
+ *   i2caddr - I2C address of the device
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+I2CRegMap::I2CRegMap(I2CBus& i2cbus, uint8_t i2caddr)
+    : bus(i2cbus)
+{
+    addr     = i2caddr;
+    maxburst = 32;
+
+    for (int i = 0; i < 256; i++)
+    {
+        types[i]  = REG_VOLATILE;
+        shadow[i] = 0;
+        valid[i]  = false;
+        dirty[i]  = false;
+    }
+}
+
+
+// I2CRegMap Protected
+// ------------------------------------------------------------------
+
+/*
+ * bool I2CRegMap::Bridge(int reg)
+ *
+ * Description:
+ *   Returns true if a clean register may be rewritten with its
+ *   shadow value to join two bursts: it must be host-owned and
+ *   its value known.
+ *
+ * Parameters:
+ *   reg - register address
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+bool I2CRegMap::Bridge(int reg)
+{
+    return types[reg] != REG_VOLATILE && valid[reg];
+}
+
+/*
+ * void I2CRegMap::Fetch(uint8_t reg, int len)
+ *
+ * Description:
+ *   Reads a range of registers from the device in one Xfer and
+ *   brings the shadow up to date. Dirty and write-only registers
+ *   keep their shadow values. Volatile registers are stored in
+ *   the shadow, for the caller to pick up, but not marked valid.
+ *
+ *   Assumes that the map mutex is held.
+ *
+ * Parameters:
+ *   reg - first register address
+ *   len - number of registers
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::Fetch(uint8_t reg, int len)
+{
+    uint8_t buf[256];
+
+    bus.Xfer(&reg, 1, buf, len, addr);
+
+    for (int i = 0; i < len; i++)
+    {
+        int r = reg + i;
+
+        if (dirty[r] || types[r] == REG_WRITEONLY)
+            continue;
+
+        shadow[r] = buf[i];
+        valid[r]  = (types[r] == REG_CACHED);
+    }
+}
+
+/*
+ * void I2CRegMap::FlushDirty(int after)
+ *
+ * Description:
+ *   Writes all dirty registers to the device in one Transfer, in
+ *   register order, followed by register after, if given.
+ *
+ *   Runs of consecutive dirty registers become auto-increment burst
+ *   writes of up to maxburst bytes. Two runs separated by no more
+ *   than MAX_BRIDGE clean, host-owned registers with known values
+ *   are joined into one burst, since rewriting those few registers
+ *   costs less bus time than starting another transaction.
+ *
+ *   Dirty flags are cleared only if the transfer succeeds.
+ *
+ *   Assumes that the map mutex is held.
+ *
+ * Parameters:
+ *   after - a register, not dirty, whose shadow value is written
+ *           last, on its own. Defaults to -1, meaning none.
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::FlushDirty(int after)
+{
+    I2CBatch batch;
+    int      pos = 0;
+    int      reg = 0;
+
+    while (reg < 256)
+    {
+        if (!dirty[reg])
+        {
+            reg++;
+            continue;
+        }
+
+        int first = reg;
+        int last  = reg;
+        int next  = reg + 1;
+
+        while (next < 256 && next - first < maxburst)
+        {
+            if (dirty[next])
+            {
+                last = next++;
+                continue;
+            }
+
+            int gap = next;
+            while (gap < 256 && !dirty[gap] && gap - next < MAX_BRIDGE && this->Bridge(gap))
+                gap++;
+
+            if (gap < 256 && dirty[gap] && gap - first < maxburst)
+                next = gap;
+            else
+                break;
+        }
+
+        int len = last - first + 1;
+
+        flushbuf[pos] = first;
+        memcpy(&flushbuf[pos + 1], &shadow[first], len);
+        batch.Write(&flushbuf[pos], len + 1, addr);
+
+        pos += len + 1;
+        reg  = last + 1;
+    }
+
+    if (after >= 0)
+    {
+        flushbuf[pos]     = after;
+        flushbuf[pos + 1] = shadow[after];
+        batch.Write(&flushbuf[pos], 2, addr);
+    }
+
+    if (batch.Size() == 0)
+        return;
+
+    bus.Transfer(batch);
+
+    for (int i = 0; i < 256; i++)
+        dirty[i] = false;
+}
+
+
+
+// I2CRegMap Public
+// ------------------------------------------------------------------
+
+/*
+ * void I2CRegMap::SetType(uint8_t reg, RegType type)
+ *
+ * Description:
+ *   Sets the type of a register. Making a register volatile
+ *   discards its cached value.
+ *
+ * Parameters:
+ *   reg  - register address
+ *   type - REG_VOLATILE, REG_CACHED, or REG_WRITEONLY
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::SetType(uint8_t reg, RegType type)
+{
+    this->SetType(reg, reg, type);
+}
+
+/*
+ * void I2CRegMap::SetType(uint8_t first, uint8_t last, RegType type)
+ *
+ * Description:
+ *   Sets the type of a range of registers, first through last
+ *   inclusive.
+ *
+ * Parameters:
+ *   first - first register address
+ *   last  - last register address
+ *   type  - REG_VOLATILE, REG_CACHED, or REG_WRITEONLY
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::SetType(uint8_t first, uint8_t last, RegType type)
+{
+    lock_guard<mutex> lck(mtx);
+
+    for (int r = first; r <= last; r++)
+    {
+        types[r] = type;
+        if (type == REG_VOLATILE)
+            valid[r] = false;
+    }
+}
+
+/*
+ * void I2CRegMap::SetMaxBurst(int len)
+ *
+ * Description:
+ *   Sets the largest number of registers Flush() may write in one
+ *   burst. Defaults to 32. Use 1 for devices that do not
+ *   auto-increment on writes.
+ *
+ * Parameters:
+ *   len - burst length, 1 to 256
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::SetMaxBurst(int len)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (len < 1)
+        len = 1;
+    if (len > 256)
+        len = 256;
+
+    maxburst = len;
+}
+
+/*
+ * uint8_t I2CRegMap::Read(uint8_t reg)
+ *
+ * Description:
+ *   Returns the value of a register. A cached register with a
+ *   known value does not touch the bus.
+ *
+ * Parameters:
+ *   reg - register address
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+uint8_t I2CRegMap::Read(uint8_t reg)
+{
+    uint8_t val;
+
+    this->Read(reg, &val, 1);
+    return val;
+}
+
+/*
+ * void I2CRegMap::Read(uint8_t reg, uint8_t* data, int len)
+ *
+ * Description:
+ *   Reads a range of consecutive registers. If every register in
+ *   the range is host-owned with a known value, the values come
+ *   from the shadow. Otherwise the whole range is read from the
+ *   device in one Xfer, and the shadow is brought up to date.
+ *
+ * Parameters:
+ *   reg  - first register address
+ *   data - a buffer to receive register values
+ *   len  - the number of registers
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::Read(uint8_t reg, uint8_t* data, int len)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (len < 1 || reg + len > 256)
+    {
+        I2CException iexc("Register range out of bounds.", "I2CRegMap::Read(reg, data, len)");
+        throw iexc;
+    }
+
+    bool cached = true;
+
+    for (int r = reg; r < reg + len; r++)
+    {
+        if (types[r] == REG_WRITEONLY && !valid[r])
+        {
+            I2CException iexc("Write-only register has not been written.", "I2CRegMap::Read(reg, data, len)");
+            throw iexc;
+        }
+        if (types[r] == REG_VOLATILE || !valid[r])
+            cached = false;
+    }
+
+    if (!cached)
+        this->Fetch(reg, len);
+
+    memcpy(data, &shadow[reg], len);
+}
+
+/*
+ * void I2CRegMap::Write(uint8_t reg, uint8_t val)
+ *
+ * Description:
+ *   Writes a register.
+ *
+ *   A host-owned register is updated in the shadow and marked dirty,
+ *   to be written by the next Flush(). Writing the value a register
+ *   already holds does nothing.
+ *
+ *   A volatile register is written at once, in one transfer with
+ *   any dirty registers. These go out first, in register order,
+ *   whatever order they were written in; the volatile register is
+ *   always written last.
+ *
+ * Parameters:
+ *   reg - register address
+ *   val - register value
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::Write(uint8_t reg, uint8_t val)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (types[reg] != REG_VOLATILE)
+    {
+        if (valid[reg] && shadow[reg] == val)
+            return;
+
+        shadow[reg] = val;
+        valid[reg]  = true;
+        dirty[reg]  = true;
+        return;
+    }
+
+    // A write held from before the register became volatile is
+    // superseded by this one.
+    shadow[reg] = val;
+    dirty[reg]  = false;
+    this->FlushDirty(reg);
+}
+
+/*
+ * void I2CRegMap::UpdateBits(uint8_t reg, uint8_t mask, uint8_t value)
+ *
+ * Description:
+ *   Sets the bits selected by mask in a register:
+ *
+ *     reg = (reg & ~mask) | (value & mask)
+ *
+ *   A host-owned register with a known value is updated in the
+ *   shadow alone, with no read, and is marked dirty only if its
+ *   value changes; the write goes out with the next Flush().
+ *
+ *   A volatile register is updated on the device at once with
+ *   I2CBus::UpdateBits(), after any dirty registers have been
+ *   flushed.
+ *
+ * Parameters:
+ *   reg   - register address
+ *   mask  - the bits to be changed
+ *   value - the new bit values, in place (not shifted)
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::UpdateBits(uint8_t reg, uint8_t mask, uint8_t value)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (types[reg] == REG_VOLATILE)
+    {
+        this->FlushDirty();
+        bus.UpdateBits(addr, reg, mask, value);
+        return;
+    }
+
+    if (!valid[reg])
+    {
+        if (types[reg] == REG_WRITEONLY)
+        {
+            I2CException iexc("Write-only register has not been written.", "I2CRegMap::UpdateBits(reg, mask, value)");
+            throw iexc;
+        }
+        this->Fetch(reg, 1);
+    }
+
+    uint8_t newval = (shadow[reg] & ~mask) | (value & mask);
+    if (newval != shadow[reg])
+    {
+        shadow[reg] = newval;
+        dirty[reg]  = true;
+    }
+}
+
+/*
+ * uint8_t I2CRegMap::ReadField(uint8_t reg, uint8_t mask)
+ *
+ * Description:
+ *   Returns the bits selected by mask in a register, shifted down
+ *   so that the lowest bit of the mask becomes bit 0. Reads the
+ *   same way Read() does.
+ *
+ * Parameters:
+ *   reg  - register address
+ *   mask - the bits of the field
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+uint8_t I2CRegMap::ReadField(uint8_t reg, uint8_t mask)
+{
+    uint8_t val = this->Read(reg) & mask;
+
+    while (mask != 0 && (mask & 0x01) == 0)
+    {
+        mask >>= 1;
+        val  >>= 1;
+    }
+
+    return val;
+}
+
+/*
+ * void I2CRegMap::Flush()
+ *
+ * Description:
+ *   Writes all dirty registers to the device, in as few burst
+ *   writes as possible, in one transfer.
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::Flush()
+{
+    lock_guard<mutex> lck(mtx);
+    this->FlushDirty();
+}
+
+/*
+ * bool I2CRegMap::Dirty()
+ *
+ * Description:
+ *   Returns true if any register is waiting to be flushed.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+bool I2CRegMap::Dirty()
+{
+    lock_guard<mutex> lck(mtx);
+
+    for (int i = 0; i < 256; i++)
+    {
+        if (dirty[i])
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * void I2CRegMap::Invalidate()
+ *
+ * Description:
+ *   Forgets every cached value and discards unflushed writes, for
+ *   instance after the device has been reset.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+void I2CRegMap::Invalidate()
+{
+    lock_guard<mutex> lck(mtx);
+
+    for (int i = 0; i < 256; i++)
+    {
+        valid[i] = false;
+        dirty[i] = false;
+    }
+}
+
+} // namespace bbbi2c
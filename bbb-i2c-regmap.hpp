@@ -0,0 +1,111 @@
+/*
+ * bbb-i2c-regmap.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    I2C register map cache header.
+ */
+
+#ifndef BBB_I2C_REGMAP_HPP_
+#define BBB_I2C_REGMAP_HPP_
+
+
+#include <mutex>
+#include <stdint.h>
+
+#include "bbb-i2c.hpp"
+
+
+namespace bbbi2c
+{
+
+/*
+ * class I2CRegMap
+ *
+ * Description:
+ *   A register map for one device with eight-bit register
+ *   addresses: a shadow copy of the device registers, kept in
+ *   step with the device through an I2CBus.
+ *
+ *   Each register has a type:
+ *     REG_VOLATILE  - changed by the device. Always read from
+ *                     the device, written through at once.
+ *                     This is the default.
+ *     REG_CACHED    - changed only by us. Read from the device
+ *                     once, then from the shadow. Writes go to
+ *                     the shadow and are marked dirty.
+ *     REG_WRITEONLY - cannot be read back. Writes go to the
+ *                     shadow and are marked dirty. Reads return
+ *                     the last value written.
+ *
+ *   UpdateBits() and ReadField() work on bit fields. On a cached
+ *   register with a known value they need no read at all, and an
+ *   update that leaves the register unchanged writes nothing.
+ *
+ *   Flush() writes every dirty register to the device, using
+ *   auto-increment burst writes over consecutive registers, all
+ *   in one I2CBus::Transfer. The device must support register
+ *   auto-increment on writes; SetMaxBurst(1) disables bursts.
+ *   Dirty registers reach the device in register order, not in
+ *   the order they were written.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-regmap.hpp
+ */
+class I2CRegMap
+{
+  public:
+    enum RegType
+    {
+        REG_VOLATILE,            // Device-owned: never cached.
+        REG_CACHED,              // Host-owned: cached, written back.
+        REG_WRITEONLY            // Host-owned, cannot be read back.
+    };
+
+  protected:
+    I2CBus&     bus;             // The bus the device lives on.
+    uint8_t     addr;            // Device address.
+    int         maxburst;        // Most data bytes per burst write.
+    std::mutex  mtx;             // Guards the shadow.
+
+    RegType     types[256];      // Register types.
+    uint8_t     shadow[256];     // Shadow register values.
+    bool        valid[256];      // Shadow value is known.
+    bool        dirty[256];      // Shadow value is not yet on the device.
+    uint8_t     flushbuf[512];   // Burst write buffer.
+
+    bool Bridge     ( int reg );
+    void Fetch      ( uint8_t reg, int len );
+    void FlushDirty ( int after = -1 );
+
+  public:
+    I2CRegMap ( I2CBus& i2cbus, uint8_t i2caddr );
+
+    I2CRegMap ( const I2CRegMap& ) = delete;
+    I2CRegMap& operator= ( const I2CRegMap& ) = delete;
+
+    void SetType     ( uint8_t reg, RegType type );
+    void SetType     ( uint8_t first, uint8_t last, RegType type );
+    void SetMaxBurst ( int len );
+
+    uint8_t Read  ( uint8_t reg );
+    void    Read  ( uint8_t reg, uint8_t* data, int len );
+    void    Write ( uint8_t reg, uint8_t val );
+
+    void    UpdateBits ( uint8_t reg, uint8_t mask, uint8_t value );
+    uint8_t ReadField  ( uint8_t reg, uint8_t mask );
+
+    void Flush      ();
+    bool Dirty      ();
+    void Invalidate ();
+
+}; // class I2CRegMap
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_REGMAP_HPP_ */
@@ -0,0 +1,238 @@
+/*
+ * bbb-i2c-ring.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Lock-free single-producer, single-consumer sample ring.
+ */
+
+#ifndef BBB_I2C_RING_HPP_
+#define BBB_I2C_RING_HPP_
+
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bbb-i2c.hpp"
+
+
+namespace bbbi2c
+{
+
+/*
+ * struct I2CSample
+ *
+ * Description:
+ *   One timestamped raw register read.
+ *
+ *   ns   - steady_clock time at which the read completed, in
+ *          nanoseconds
+ *   addr - I2C address of the device
+ *   reg  - first register address
+ *   len  - the number of bytes in data
+ *   data - register values
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-ring.hpp
+ */
+template <size_t LEN>
+struct I2CSample
+{
+    uint64_t  ns;
+    uint8_t   addr;
+    uint8_t   reg;
+    uint16_t  len;
+    uint8_t   data[LEN];
+};
+
+/*
+ * class I2CRing
+ *
+ * Description:
+ *   A bounded ring of N slots of type T, for handing samples from
+ *   one producer thread to one consumer thread without locks or
+ *   allocation. N must be a power of two.
+ *
+ *   The producer fills a slot in place: Acquire() returns the next
+ *   free slot (or nullptr if the ring is full) and Commit()
+ *   publishes it. The consumer does the same with Front() and
+ *   Release(). Push() and Pop() copy a whole slot instead.
+ *
+ *   The head and tail indexes live on separate cache lines, and
+ *   each side keeps a private copy of the other side's index, so
+ *   that in the steady state neither side reads a cache line the
+ *   other is writing. A full ring drops new samples rather than
+ *   making the producer wait; Dropped() counts them.
+ *
+ *   Only one thread may produce and only one may consume.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-ring.hpp
+ */
+template <typename T, size_t N>
+class I2CRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "I2CRing size must be a power of two.");
+
+  protected:
+    static const size_t LINE = 64;           // Cache line size.
+
+    alignas(LINE) std::atomic<size_t> head;  // Next slot to be filled.
+    size_t                tailcache;         // Producer's copy of tail.
+    std::atomic<uint64_t> dropped;           // Samples refused because the ring was full.
+
+    alignas(LINE) std::atomic<size_t> tail;  // Next slot to be consumed.
+    size_t                headcache;         // Consumer's copy of head.
+
+    alignas(LINE) T       slots[N];          // Sample storage.
+
+  public:
+    I2CRing ()
+        : head(0), tailcache(0), dropped(0), tail(0), headcache(0)
+    { }
+
+    I2CRing ( const I2CRing& ) = delete;
+    I2CRing& operator= ( const I2CRing& ) = delete;
+
+    // Producer
+
+    T* Acquire ()
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if (h - tailcache == N)
+        {
+            tailcache = tail.load(std::memory_order_acquire);
+            if (h - tailcache == N)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+
+        return &slots[h & (N - 1)];
+    }
+
+    void Commit ()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool Push ( const T& item )
+    {
+        T* slot = this->Acquire();
+        if (slot == nullptr)
+            return false;
+
+        *slot = item;
+        this->Commit();
+        return true;
+    }
+
+    // Consumer
+
+    T* Front ()
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if (t == headcache)
+        {
+            headcache = head.load(std::memory_order_acquire);
+            if (t == headcache)
+                return nullptr;
+        }
+
+        return &slots[t & (N - 1)];
+    }
+
+    void Release ()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool Pop ( T& item )
+    {
+        T* slot = this->Front();
+        if (slot == nullptr)
+            return false;
+
+        item = *slot;
+        this->Release();
+        return true;
+    }
+
+    // Either side
+
+    size_t Size () const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    uint64_t Dropped () const
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+}; // class I2CRing
+
+/*
+ * bool I2CRingSample(I2CBus& bus, I2CRing<I2CSample<LEN>, N>& ring, uint8_t i2caddr, uint8_t reg, int len)
+ *
+ * Description:
+ *   Reads consecutive registers straight into the next free slot of
+ *   a sample ring, stamps the slot with the completion time, and
+ *   publishes it. Returns false, without touching the bus, if the
+ *   ring is full.
+ *
+ *   To be called from the ring's producer thread only.
+ *
+ * Parameters:
+ *   bus     - the bus the device lives on
+ *   ring    - the sample ring
+ *   i2caddr - I2C address of the device
+ *   reg     - first register address
+ *   len     - the number of registers, at most LEN
+ *
+ * Exceptions:
+ *   I2CException - the read failed. The slot is not published.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-ring.hpp
+ */
+template <size_t LEN, size_t N>
+bool I2CRingSample(I2CBus& bus, I2CRing<I2CSample<LEN>, N>& ring, uint8_t i2caddr, uint8_t reg, int len)
+{
+    I2CSample<LEN>* s = ring.Acquire();
+    if (s == nullptr)
+        return false;
+
+    if (len > (int)LEN)
+        len = LEN;
+
+    s->addr = i2caddr;
+    s->reg  = reg;
+    s->len  = len;
+    bus.Xfer(&s->reg, 1, s->data, len, i2caddr);
+    s->ns   = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    ring.Commit();
+    return true;
+}
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_RING_HPP_ */
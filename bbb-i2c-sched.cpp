@@ -0,0 +1,399 @@
+/*
+ * bbb-i2c-sched.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements the periodic I2C sampling scheduler.
+ */
+
+
+#include "bbb-i2c-sched.hpp"
+
+#include <algorithm>          // sort
+#include <chrono>             // steady_clock, microseconds, nanoseconds
+#include <condition_variable> // condition_variable
+#include <exception>          // exception_ptr, current_exception
+#include <linux/i2c-dev.h>    // I2C_RDWR_IOCTL_MAX_MSGS
+#include <mutex>              // mutex, lock_guard, unique_lock
+#include <stdint.h>           // uint8_t, uint64_t
+#include <thread>             // thread, this_thread
+#include <vector>             // vector
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+// I2CScheduler Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CScheduler::I2CScheduler(I2CBus& i2cbus, chrono::microseconds win)
+ *
+ * Description:
+ *   Constructor. Starts the timer thread, with no reads scheduled.
+ *
+ * Parameters:
+ *   i2cbus - the bus to be sampled
+ *   win    - the batching window: reads released within this
+ *            time of each other are carried out together.
+ *            Defaults to 500 us.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+I2CScheduler::I2CScheduler(I2CBus& i2cbus, chrono::microseconds win)
+    : bus(i2cbus)
+{
+    window      = win;
+    nextid      = 1;
+    dispatching = false;
+    stopping    = false;
+    timer       = thread(&I2CScheduler::Run, this);
+}
+
+/*
+ * I2CScheduler::~I2CScheduler()
+ *
+ * Description:
+ *   Destructor. Stops the timer thread. A batch already dispatched
+ *   is allowed to finish.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+I2CScheduler::~I2CScheduler()
+{
+    {
+        lock_guard<mutex> lck(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    timer.join();
+}
+
+
+// I2CScheduler Protected
+// ------------------------------------------------------------------
+
+/*
+ * void I2CScheduler::Dispatch(vector<Job>& jobs)
+ *
+ * Description:
+ *   Carries out a group of reads in one Transfer and delivers the
+ *   results. An exception thrown by a callback is discarded, so
+ *   that it cannot take down the timer thread.
+ *
+ *   If the combined Transfer fails, the reads are carried out
+ *   again one by one, and each callback receives only its own
+ *   read's exception. A device that is absent then fails its own
+ *   reads, not every read batched with it.
+ *
+ *   Called without the scheduler mutex held.
+ *
+ * Parameters:
+ *   jobs - the reads to be carried out
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+void I2CScheduler::Dispatch(vector<Job>& jobs)
+{
+    I2CBatch              batch;
+    vector<exception_ptr> excs(jobs.size());
+
+    for (auto& job : jobs)
+        batch.Xfer(&job.reg, 1, job.data.data(), job.data.size(), job.addr);
+
+    try
+    {
+        bus.Transfer(batch);
+    }
+    catch (...)
+    {
+        if (jobs.size() == 1)
+            excs[0] = current_exception();
+        else
+        {
+            for (size_t i = 0; i < jobs.size(); i++)
+            {
+                Job& job = jobs[i];
+                try
+                {
+                    bus.Xfer(&job.reg, 1, job.data.data(), job.data.size(), job.addr);
+                }
+                catch (...)
+                {
+                    excs[i] = current_exception();
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        try
+        {
+            jobs[i].done(jobs[i].data.data(), jobs[i].data.size(), excs[i]);
+        }
+        catch (...)
+        { }
+    }
+}
+
+/*
+ * void I2CScheduler::Run()
+ *
+ * Description:
+ *   Timer thread. Sleeps until the earliest release time, then
+ *   gathers every read released by the end of the batching window,
+ *   orders them by deadline, and dispatches as many as fit into
+ *   one I2C_RDWR ioctl. Reads left over go out on the next pass.
+ *
+ *   After a dispatch, each read's timing record is updated and its
+ *   next release is advanced by one period, or by more if it has
+ *   fallen a whole period behind.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+void I2CScheduler::Run()
+{
+    const size_t maxjobs = I2C_RDWR_IOCTL_MAX_MSGS / 2;
+
+    vector<int> ready;
+    vector<Job> jobs;
+
+    unique_lock<mutex> lck(mtx);
+
+    while (!stopping)
+    {
+        if (tasks.empty())
+        {
+            cv.wait(lck);
+            continue;
+        }
+
+        TimePoint first = tasks.begin()->second.release;
+        for (auto& entry : tasks)
+        {
+            if (entry.second.release < first)
+                first = entry.second.release;
+        }
+
+        TimePoint now = chrono::steady_clock::now();
+        if (now < first)
+        {
+            cv.wait_until(lck, first);
+            continue;
+        }
+
+        ready.clear();
+        for (auto& entry : tasks)
+        {
+            if (entry.second.release <= now + window)
+                ready.push_back(entry.first);
+        }
+
+        sort(ready.begin(), ready.end(), [this](int a, int b)
+        {
+            Task& ta = tasks[a];
+            Task& tb = tasks[b];
+            return ta.release + ta.period < tb.release + tb.period;
+        });
+
+        if (ready.size() > maxjobs)
+            ready.resize(maxjobs);
+
+        jobs.clear();
+        for (int id : ready)
+        {
+            Task& t = tasks[id];
+            Job   job;
+
+            job.id       = id;
+            job.addr     = t.addr;
+            job.reg      = t.reg;
+            job.release  = t.release;
+            job.deadline = t.release + t.period;
+            job.done     = t.done;
+            job.data.resize(t.len);
+
+            jobs.push_back(job);
+
+            t.release += t.period;
+        }
+
+        dispatching = true;
+        lck.unlock();
+
+        this->Dispatch(jobs);
+
+        TimePoint end = chrono::steady_clock::now();
+
+        lck.lock();
+        dispatching = false;
+
+        for (auto& job : jobs)
+        {
+            auto it = tasks.find(job.id);
+            if (it == tasks.end())
+                continue;
+
+            Task& t = it->second;
+
+            t.stats.runs++;
+
+            if (now > job.release)
+            {
+                uint64_t late = chrono::duration_cast<chrono::nanoseconds>(now - job.release).count();
+                if (late > t.stats.maxlatency)
+                    t.stats.maxlatency = late;
+            }
+
+            if (end > job.deadline)
+                t.stats.misses++;
+
+            while (t.release + t.period <= end)
+            {
+                t.release += t.period;
+                t.stats.skipped++;
+            }
+        }
+
+        cv.notify_all();
+    }
+}
+
+
+// I2CScheduler Public
+// ------------------------------------------------------------------
+
+/*
+ * int I2CScheduler::Add(uint8_t i2caddr, uint8_t reg, int len, chrono::microseconds period, Callback done)
+ *
+ * Description:
+ *   Schedules a periodic read of consecutive registers and returns
+ *   an id for Remove() and GetStats(). The first read is released
+ *   at once.
+ *
+ * Parameters:
+ *   i2caddr - I2C address of the device
+ *   reg     - first register address
+ *   len     - the number of registers to read
+ *   period  - the sampling period
+ *   done    - called with the registers read, or with the transfer
+ *             exception, after each read
+ *
+ * Exceptions:
+ *   I2CException - len or period is out of range.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+int I2CScheduler::Add(uint8_t i2caddr, uint8_t reg, int len, chrono::microseconds period, Callback done)
+{
+    if (len < 1 || period.count() <= 0)
+    {
+        I2CException iexc("Invalid length or period.", "I2CScheduler::Add(i2caddr, reg, len, period, done)");
+        throw iexc;
+    }
+
+    int id;
+    {
+        lock_guard<mutex> lck(mtx);
+
+        id = nextid++;
+
+        Task& t = tasks[id];
+        t.addr    = i2caddr;
+        t.reg     = reg;
+        t.len     = len;
+        t.period  = period;
+        t.release = chrono::steady_clock::now();
+        t.done    = done;
+        t.stats   = I2CSchedStats();
+    }
+    cv.notify_all();
+
+    return id;
+}
+
+/*
+ * void I2CScheduler::Remove(int id)
+ *
+ * Description:
+ *   Cancels a periodic read. If the read has been dispatched,
+ *   waits for its callback to return, so that no callback runs
+ *   after Remove() returns. May be called from a callback.
+ *
+ * Parameters:
+ *   id - the id returned by Add()
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+void I2CScheduler::Remove(int id)
+{
+    unique_lock<mutex> lck(mtx);
+
+    tasks.erase(id);
+
+    if (this_thread::get_id() != timer.get_id())
+        cv.wait(lck, [this] { return !dispatching; });
+}
+
+/*
+ * I2CSchedStats I2CScheduler::GetStats(int id)
+ *
+ * Description:
+ *   Returns the timing record of a periodic read.
+ *
+ * Parameters:
+ *   id - the id returned by Add()
+ *
+ * Exceptions:
+ *   I2CException - no such read.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+I2CSchedStats I2CScheduler::GetStats(int id)
+{
+    lock_guard<mutex> lck(mtx);
+
+    auto it = tasks.find(id);
+    if (it == tasks.end())
+    {
+        I2CException iexc("No such periodic read.", "I2CScheduler::GetStats(id)");
+        throw iexc;
+    }
+
+    return it->second.stats;
+}
+
+} // namespace bbbi2c
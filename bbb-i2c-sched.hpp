@@ -0,0 +1,148 @@
+/*
+ * bbb-i2c-sched.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Periodic I2C sampling scheduler header.
+ */
+
+#ifndef BBB_I2C_SCHED_HPP_
+#define BBB_I2C_SCHED_HPP_
+
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "bbb-i2c.hpp"
+
+
+namespace bbbi2c
+{
+
+/*
+ * struct I2CSchedStats
+ *
+ * Description:
+ *   Timing record for one periodic read.
+ *
+ *   runs       - reads carried out
+ *   misses     - reads that completed after their deadline
+ *   skipped    - periods dropped because the read fell a whole
+ *                period or more behind
+ *   maxlatency - the longest delay from release to dispatch, in
+ *                nanoseconds
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+struct I2CSchedStats
+{
+    uint64_t  runs;
+    uint64_t  misses;
+    uint64_t  skipped;
+    uint64_t  maxlatency;
+};
+
+/*
+ * class I2CScheduler
+ *
+ * Description:
+ *   Runs periodic register reads on an I2CBus from one timer
+ *   thread.
+ *
+ *   Each read is released once per period, on a fixed timeline
+ *   that does not drift with dispatch delays, and is due by its
+ *   next release. Released reads are dispatched earliest deadline
+ *   first. Reads released within the batching window of each
+ *   other are carried out together in one I2CBus::Transfer, up to
+ *   as many as fit into a single I2C_RDWR ioctl.
+ *
+ *   A read that completes after its deadline counts as a miss. A
+ *   read that falls a whole period behind drops the periods it
+ *   missed instead of running them back to back.
+ *
+ *   Results are delivered to a callback on the timer thread, which
+ *   should be short. If a combined transfer fails, its reads are
+ *   retried one at a time, and each receives only its own
+ *   exception.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sched.hpp
+ */
+class I2CScheduler
+{
+  public:
+    typedef std::function<void (const uint8_t* data, int len, std::exception_ptr exc)> Callback;
+
+  protected:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct Task
+    {
+        uint8_t                    addr;     // Device address.
+        uint8_t                    reg;      // First register.
+        int                        len;      // Registers to read.
+        std::chrono::microseconds  period;   // Sampling period.
+        TimePoint                  release;  // Next release time.
+        Callback                   done;     // Result callback.
+        I2CSchedStats              stats;    // Timing record.
+    };
+
+    struct Job
+    {
+        int                   id;        // Task id.
+        uint8_t               addr;      // Device address.
+        uint8_t               reg;       // First register.
+        TimePoint             release;   // Release time of this run.
+        TimePoint             deadline;  // Deadline of this run.
+        std::vector<uint8_t>  data;      // Registers read.
+        Callback              done;      // Result callback.
+    };
+
+    I2CBus&                    bus;          // The bus being sampled.
+    std::chrono::microseconds  window;       // Batching window.
+    std::map<int, Task>        tasks;        // Periodic reads, by id.
+    int                        nextid;       // Id for the next Add().
+    bool                       dispatching;  // Timer thread is running jobs.
+    bool                       stopping;     // Timer thread is to exit.
+    std::mutex                 mtx;          // Guards everything above.
+    std::condition_variable    cv;           // Signals the timer thread and Remove().
+    std::thread                timer;        // Timer thread.
+
+    void Dispatch ( std::vector<Job>& jobs );
+    void Run      ();
+
+  public:
+    I2CScheduler ( I2CBus& i2cbus,
+                   std::chrono::microseconds win = std::chrono::microseconds(500) );
+   ~I2CScheduler ();
+
+    I2CScheduler ( const I2CScheduler& ) = delete;
+    I2CScheduler& operator= ( const I2CScheduler& ) = delete;
+
+    int  Add    ( uint8_t i2caddr, uint8_t reg, int len,
+                  std::chrono::microseconds period, Callback done );
+    void Remove ( int id );
+
+    I2CSchedStats GetStats ( int id );
+
+}; // class I2CScheduler
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_SCHED_HPP_ */
@@ -0,0 +1,434 @@
+/*
+ * bbb-i2c-shm.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements shared-memory publication of I2C readings.
+ */
+
+
+#include "bbb-i2c-shm.hpp"
+
+#include <atomic>            // atomic, atomic_thread_fence
+#include <chrono>            // steady_clock, nanoseconds
+#include <fcntl.h>           // O_CREAT, O_RDWR, O_RDONLY
+#include <mutex>             // mutex, lock_guard
+#include <sstream>           // stringstream
+#include <stdint.h>          // uint8_t, uint32_t, uint64_t
+#include <string.h>          // memcpy
+#include <sys/mman.h>        // shm_open(), shm_unlink(), mmap(), munmap()
+#include <sys/stat.h>        // fstat()
+#include <thread>            // this_thread::yield()
+#include <unistd.h>          // close(), ftruncate()
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+// I2CShmPublisher Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CShmPublisher::I2CShmPublisher(const char* shmname)
+ *
+ * Description:
+ *   Constructor. Creates the shared-memory segment, or takes over
+ *   an existing one, and clears it.
+ *
+ * Parameters:
+ *   shmname - POSIX shared-memory name, such as "/bbb-i2c-1"
+ *
+ * Exceptions:
+ *   I2CException - the segment cannot be created or mapped.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+I2CShmPublisher::I2CShmPublisher(const char* shmname)
+{
+    name = shmname;
+
+    int fd = shm_open(shmname, O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(I2CShmSegment)) < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+
+        stringstream ss;
+        ss << "Unable to create shared memory " << name;
+        I2CException iexc(ss.str(), "I2CShmPublisher::I2CShmPublisher(shmname)");
+        throw iexc;
+    }
+
+    void* p = mmap(nullptr, sizeof(I2CShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED)
+    {
+        stringstream ss;
+        ss << "Unable to map shared memory " << name;
+        I2CException iexc(ss.str(), "I2CShmPublisher::I2CShmPublisher(shmname)");
+        throw iexc;
+    }
+
+    seg = static_cast<I2CShmSegment*>(p);
+
+    // A segment left by an earlier publisher may hold old readings,
+    // and a slot it was updating when it died has an odd sequence
+    // count. Rounding that down keeps the count even between updates.
+    seg->magic.store(0, memory_order_relaxed);
+    seg->nslots = I2C_SHM_SLOTS;
+    for (int i = 0; i < I2C_SHM_SLOTS; i++)
+    {
+        I2CShmSlot& slot = seg->slots[i];
+
+        slot.key.store(0, memory_order_relaxed);
+        slot.seq.store(slot.seq.load(memory_order_relaxed) & ~1u, memory_order_relaxed);
+    }
+    seg->magic.store(I2C_SHM_MAGIC, memory_order_release);
+}
+
+/*
+ * I2CShmPublisher::~I2CShmPublisher()
+ *
+ * Description:
+ *   Destructor. Unmaps the segment, but leaves it in place, so that
+ *   readers keep the last readings. Call Unlink() to remove it.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+I2CShmPublisher::~I2CShmPublisher()
+{
+    munmap(seg, sizeof(I2CShmSegment));
+}
+
+
+// I2CShmPublisher Public
+// ------------------------------------------------------------------
+
+/*
+ * void I2CShmPublisher::Publish(uint8_t i2caddr, uint8_t reg, const uint8_t* data, int len)
+ *
+ * Description:
+ *   Stores a reading, stamped with the current time, in its slot,
+ *   allocating the slot on first use.
+ *
+ *   The slot's sequence count is made odd before the update and
+ *   even again after it, so that a reader can tell whether its
+ *   copy was torn.
+ *
+ * Parameters:
+ *   i2caddr - I2C address of the device
+ *   reg     - first register address
+ *   data    - the register values
+ *   len     - the number of bytes in data, 1 to I2C_SHM_DATA
+ *
+ * Exceptions:
+ *   I2CException - len is out of range, or every slot is in use.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+void I2CShmPublisher::Publish(uint8_t i2caddr, uint8_t reg, const uint8_t* data, int len)
+{
+    if (len < 1 || len > I2C_SHM_DATA)
+    {
+        I2CException iexc("Invalid reading length.", "I2CShmPublisher::Publish(i2caddr, reg, data, len)");
+        throw iexc;
+    }
+
+    uint32_t key   = 0x80000000u | (i2caddr << 8) | reg;
+    uint32_t words[I2C_SHM_DATA / 4] = { 0 };
+    uint64_t ns    = chrono::duration_cast<chrono::nanoseconds>(
+                         chrono::steady_clock::now().time_since_epoch()).count();
+
+    memcpy(words, data, len);
+
+    lock_guard<mutex> lck(mtx);
+
+    bool fresh = false;
+    auto it    = index.find(key);
+    if (it == index.end())
+    {
+        if (index.size() >= (size_t)I2C_SHM_SLOTS)
+        {
+            I2CException iexc("Shared memory segment full.", "I2CShmPublisher::Publish(i2caddr, reg, data, len)");
+            throw iexc;
+        }
+
+        it    = index.insert(make_pair(key, (int)index.size())).first;
+        fresh = true;
+    }
+
+    I2CShmSlot& slot = seg->slots[it->second];
+    uint32_t    seq  = slot.seq.load(memory_order_relaxed);
+
+    slot.seq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (int i = 0; i < I2C_SHM_DATA / 4; i++)
+        slot.data[i].store(words[i], memory_order_relaxed);
+    slot.len.store(len, memory_order_relaxed);
+    slot.nslo.store((uint32_t)ns, memory_order_relaxed);
+    slot.nshi.store((uint32_t)(ns >> 32), memory_order_relaxed);
+
+    slot.seq.store(seq + 2, memory_order_release);
+
+    if (fresh)
+        slot.key.store(key, memory_order_release);
+}
+
+/*
+ * void I2CShmPublisher::Sample(I2CBus& bus, uint8_t i2caddr, uint8_t reg, int len)
+ *
+ * Description:
+ *   Reads consecutive registers in one Xfer and publishes them.
+ *
+ * Parameters:
+ *   bus     - the bus the device lives on
+ *   i2caddr - I2C address of the device
+ *   reg     - first register address
+ *   len     - the number of registers, 1 to I2C_SHM_DATA
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+void I2CShmPublisher::Sample(I2CBus& bus, uint8_t i2caddr, uint8_t reg, int len)
+{
+    uint8_t data[I2C_SHM_DATA];
+
+    if (len < 1 || len > I2C_SHM_DATA)
+    {
+        I2CException iexc("Invalid reading length.", "I2CShmPublisher::Sample(bus, i2caddr, reg, len)");
+        throw iexc;
+    }
+
+    bus.Xfer(&reg, 1, data, len, i2caddr);
+    this->Publish(i2caddr, reg, data, len);
+}
+
+/*
+ * void I2CShmPublisher::Unlink()
+ *
+ * Description:
+ *   Removes the segment name. Readers that have it mapped keep it
+ *   until they unmap it; new readers can no longer open it.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+void I2CShmPublisher::Unlink()
+{
+    shm_unlink(name.c_str());
+}
+
+
+
+// I2CShmReader Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CShmReader::I2CShmReader(const char* shmname)
+ *
+ * Description:
+ *   Constructor. Maps a segment created by an I2CShmPublisher,
+ *   read-only.
+ *
+ * Parameters:
+ *   shmname - POSIX shared-memory name given to the publisher
+ *
+ * Exceptions:
+ *   I2CException - the segment does not exist, cannot be mapped,
+ *                  or was not made by a publisher.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+I2CShmReader::I2CShmReader(const char* shmname)
+{
+    struct stat st;
+    void*       p  = MAP_FAILED;
+    int         fd = shm_open(shmname, O_RDONLY, 0);
+
+    if (fd >= 0)
+    {
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(I2CShmSegment))
+            p = mmap(nullptr, sizeof(I2CShmSegment), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+
+    if (p == MAP_FAILED)
+    {
+        stringstream ss;
+        ss << "Unable to map shared memory " << shmname;
+        I2CException iexc(ss.str(), "I2CShmReader::I2CShmReader(shmname)");
+        throw iexc;
+    }
+
+    seg = static_cast<const I2CShmSegment*>(p);
+
+    if (seg->magic.load(memory_order_acquire) != I2C_SHM_MAGIC)
+    {
+        munmap(const_cast<I2CShmSegment*>(seg), sizeof(I2CShmSegment));
+
+        stringstream ss;
+        ss << "Not an I2C reading segment: " << shmname;
+        I2CException iexc(ss.str(), "I2CShmReader::I2CShmReader(shmname)");
+        throw iexc;
+    }
+}
+
+/*
+ * I2CShmReader::~I2CShmReader()
+ *
+ * Description:
+ *   Destructor. Unmaps the segment.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+I2CShmReader::~I2CShmReader()
+{
+    munmap(const_cast<I2CShmSegment*>(seg), sizeof(I2CShmSegment));
+}
+
+
+// I2CShmReader Protected
+// ------------------------------------------------------------------
+
+/*
+ * const I2CShmSlot* I2CShmReader::Find(uint8_t i2caddr, uint8_t reg) const
+ *
+ * Description:
+ *   Returns the slot holding a reading, or nullptr if it has not
+ *   been published. Slots are allocated in order, so the search
+ *   stops at the first unused one.
+ *
+ * Parameters:
+ *   i2caddr - I2C address of the device
+ *   reg     - first register address
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+const I2CShmSlot* I2CShmReader::Find(uint8_t i2caddr, uint8_t reg) const
+{
+    uint32_t key = 0x80000000u | (i2caddr << 8) | reg;
+
+    for (int i = 0; i < I2C_SHM_SLOTS; i++)
+    {
+        uint32_t k = seg->slots[i].key.load(memory_order_acquire);
+
+        if (k == key)
+            return &seg->slots[i];
+        if (k == 0)
+            break;
+    }
+
+    return nullptr;
+}
+
+
+// I2CShmReader Public
+// ------------------------------------------------------------------
+
+/*
+ * int I2CShmReader::Read(uint8_t i2caddr, uint8_t reg, uint8_t* data, int len, uint64_t* ns) const
+ *
+ * Description:
+ *   Copies the latest reading of a run of registers and returns
+ *   the number of bytes copied: the smaller of len and the length
+ *   published. Returns 0 if nothing has been published for these
+ *   registers.
+ *
+ *   The copy is retried until it was not overlapped by an update,
+ *   so it is never torn. If the publisher is preempted partway
+ *   through an update, the reader yields rather than spinning.
+ *
+ * Parameters:
+ *   i2caddr - I2C address of the device
+ *   reg     - first register address
+ *   data    - buffer to receive the reading
+ *   len     - the size of data
+ *   ns      - if not null, receives the steady_clock time of the
+ *             reading in nanoseconds
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+int I2CShmReader::Read(uint8_t i2caddr, uint8_t reg, uint8_t* data, int len, uint64_t* ns) const
+{
+    const I2CShmSlot* slot = this->Find(i2caddr, reg);
+    if (slot == nullptr)
+        return 0;
+
+    uint32_t words[I2C_SHM_DATA / 4];
+    uint32_t n, lo, hi;
+
+    for (int spins = 0; ; spins++)
+    {
+        uint32_t seq = slot->seq.load(memory_order_acquire);
+
+        if ((seq & 1) == 0)
+        {
+            for (int i = 0; i < I2C_SHM_DATA / 4; i++)
+                words[i] = slot->data[i].load(memory_order_relaxed);
+            n  = slot->len.load(memory_order_relaxed);
+            lo = slot->nslo.load(memory_order_relaxed);
+            hi = slot->nshi.load(memory_order_relaxed);
+
+            atomic_thread_fence(memory_order_acquire);
+            if (slot->seq.load(memory_order_relaxed) == seq)
+                break;
+        }
+
+        if (spins >= 100)
+            this_thread::yield();
+    }
+
+    if ((int)n > len)
+        n = len;
+
+    memcpy(data, words, n);
+    if (ns != nullptr)
+        *ns = ((uint64_t)hi << 32) | lo;
+
+    return n;
+}
+
+} // namespace bbbi2c
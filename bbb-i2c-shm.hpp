@@ -0,0 +1,164 @@
+/*
+ * bbb-i2c-shm.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Shared-memory publication of I2C readings header.
+ */
+
+#ifndef BBB_I2C_SHM_HPP_
+#define BBB_I2C_SHM_HPP_
+
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+#include "bbb-i2c.hpp"
+
+
+namespace bbbi2c
+{
+
+const uint32_t I2C_SHM_MAGIC = 0x49324331;   // "I2C1"
+const int      I2C_SHM_SLOTS = 64;           // Readings per segment.
+const int      I2C_SHM_DATA  = 40;           // Most bytes per reading.
+
+/*
+ * struct I2CShmSlot
+ *
+ * Description:
+ *   One reading in a shared-memory segment: the latest value of a
+ *   run of registers, under a seqlock. Exactly one cache line.
+ *
+ *   seq  - sequence count, odd while the reading is being updated
+ *   key  - 0 if unused, otherwise 0x80000000 | addr << 8 | reg
+ *   nslo - steady_clock time of the reading, in nanoseconds,
+ *   nshi   low and high words
+ *   len  - the number of bytes in the reading
+ *   data - the reading, packed four bytes to a word
+ *
+ *   Every field is an atomic, so that readers never race with the
+ *   writer, even on a torn read that the seqlock will discard.
+ *   Fields are 32-bit so that loads need no read-modify-write
+ *   sequence on 32-bit ARM, which would fault on the readers'
+ *   read-only mapping.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+struct alignas(64) I2CShmSlot
+{
+    std::atomic<uint32_t>  seq;
+    std::atomic<uint32_t>  key;
+    std::atomic<uint32_t>  nslo;
+    std::atomic<uint32_t>  nshi;
+    std::atomic<uint32_t>  len;
+    uint32_t               pad;
+    std::atomic<uint32_t>  data[I2C_SHM_DATA / 4];
+};
+
+/*
+ * struct I2CShmSegment
+ *
+ * Description:
+ *   Layout of a shared-memory segment.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+struct I2CShmSegment
+{
+    std::atomic<uint32_t>  magic;
+    uint32_t               nslots;
+    I2CShmSlot             slots[I2C_SHM_SLOTS];
+};
+
+/*
+ * class I2CShmPublisher
+ *
+ * Description:
+ *   Publishes the latest readings of polled registers in a POSIX
+ *   shared-memory segment, for any number of I2CShmReaders in other
+ *   processes. Only the process that owns the bus polls it; readers
+ *   cost the bus nothing.
+ *
+ *   Each run of registers (device address and first register) gets
+ *   a slot the first time it is published. A segment holds up to
+ *   I2C_SHM_SLOTS readings of up to I2C_SHM_DATA bytes each.
+ *
+ *   There should be one publisher per segment.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+class I2CShmPublisher
+{
+  protected:
+    string                  name;     // Segment name.
+    I2CShmSegment*          seg;      // Mapped segment.
+    std::map<uint32_t, int> index;    // Slot numbers, by key.
+    std::mutex              mtx;      // Guards index and slot updates.
+
+  public:
+    I2CShmPublisher ( const char* shmname );
+   ~I2CShmPublisher ();
+
+    I2CShmPublisher ( const I2CShmPublisher& ) = delete;
+    I2CShmPublisher& operator= ( const I2CShmPublisher& ) = delete;
+
+    void Publish ( uint8_t i2caddr, uint8_t reg, const uint8_t* data, int len );
+    void Sample  ( I2CBus& bus, uint8_t i2caddr, uint8_t reg, int len );
+    void Unlink  ();
+
+}; // class I2CShmPublisher
+
+/*
+ * class I2CShmReader
+ *
+ * Description:
+ *   Reads readings published by an I2CShmPublisher. A read is a
+ *   few loads from shared memory, with no system calls and no
+ *   locks, and always returns a consistent copy of one reading.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-shm.hpp
+ */
+class I2CShmReader
+{
+  protected:
+    const I2CShmSegment*  seg;       // Mapped segment.
+
+    const I2CShmSlot* Find ( uint8_t i2caddr, uint8_t reg ) const;
+
+  public:
+    I2CShmReader ( const char* shmname );
+   ~I2CShmReader ();
+
+    I2CShmReader ( const I2CShmReader& ) = delete;
+    I2CShmReader& operator= ( const I2CShmReader& ) = delete;
+
+    int Read ( uint8_t i2caddr, uint8_t reg, uint8_t* data, int len,
+               uint64_t* ns = nullptr ) const;
+
+}; // class I2CShmReader
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_SHM_HPP_ */
@@ -0,0 +1,831 @@
+/*
+ * bbb-i2c-sim.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements the simulated I2C bus and device models.
+ */
+
+
+#include "bbb-i2c-sim.hpp"
+
+#include <chrono>            // microseconds
+#include <errno.h>           // errno, ENXIO, EREMOTEIO, EBADF, EINVAL, EOPNOTSUPP
+#include <linux/i2c.h>       // i2c_msg, I2C_M_RD
+#include <linux/i2c-dev.h>   // I2C_RDWR_IOCTL_MAX_MSGS
+#include <mutex>             // mutex, lock_guard
+#include <stdint.h>          // uint8_t
+#include <string.h>          // memset
+#include <thread>            // this_thread::sleep_for
+#include <vector>            // vector
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+// I2CSimDevice
+// ------------------------------------------------------------------
+
+/*
+ * I2CSimDevice::~I2CSimDevice()
+ *
+ * Description:
+ *   Destructor.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+I2CSimDevice::~I2CSimDevice()
+{ }
+
+/*
+ * bool I2CSimDevice::Start(bool read)
+ *
+ * Description:
+ *   Called when a START or repeated START is addressed to the
+ *   device. The default ACKs every address.
+ *
+ * Parameters:
+ *   read - true for a read, false for a write
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+bool I2CSimDevice::Start(bool read)
+{
+    (void)read;
+    return true;
+}
+
+/*
+ * void I2CSimDevice::Stop()
+ *
+ * Description:
+ *   Called at the STOP that ends a transaction in which the device
+ *   was addressed. The default does nothing.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimDevice::Stop()
+{ }
+
+
+
+// I2CSimRegisters
+// ------------------------------------------------------------------
+
+/*
+ * I2CSimRegisters::I2CSimRegisters()
+ *
+ * Description:
+ *   Constructor. Clears the registers and the register pointer.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+I2CSimRegisters::I2CSimRegisters()
+{
+    memset(regs, 0, sizeof(regs));
+    ptr        = 0;
+    addressing = false;
+}
+
+/*
+ * bool I2CSimRegisters::Start(bool read)
+ *
+ * Description:
+ *   A write START makes the next byte a register address.
+ *
+ * Parameters:
+ *   read - true for a read, false for a write
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+bool I2CSimRegisters::Start(bool read)
+{
+    addressing = !read;
+    return true;
+}
+
+/*
+ * bool I2CSimRegisters::Write(const uint8_t* data, int len)
+ *
+ * Description:
+ *   Sets the register pointer from the first byte after a START
+ *   and stores the remaining bytes, auto-incrementing.
+ *
+ * Parameters:
+ *   data - the bytes written by the master
+ *   len  - the number of bytes
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+bool I2CSimRegisters::Write(const uint8_t* data, int len)
+{
+    lock_guard<mutex> lck(mtx);
+
+    for (int i = 0; i < len; i++)
+    {
+        if (addressing)
+        {
+            ptr        = data[i];
+            addressing = false;
+        }
+        else
+        {
+            regs[ptr++] = data[i];
+        }
+    }
+
+    return true;
+}
+
+/*
+ * void I2CSimRegisters::Read(uint8_t* data, int len)
+ *
+ * Description:
+ *   Returns registers starting at the register pointer,
+ *   auto-incrementing.
+ *
+ * Parameters:
+ *   data - a buffer to receive data
+ *   len  - the number of bytes to be read
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimRegisters::Read(uint8_t* data, int len)
+{
+    lock_guard<mutex> lck(mtx);
+
+    for (int i = 0; i < len; i++)
+        data[i] = regs[ptr++];
+}
+
+/*
+ * uint8_t I2CSimRegisters::Peek(uint8_t reg)
+ *
+ * Description:
+ *   Returns a register value without going through the bus.
+ *
+ * Parameters:
+ *   reg - register address
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+uint8_t I2CSimRegisters::Peek(uint8_t reg)
+{
+    lock_guard<mutex> lck(mtx);
+    return regs[reg];
+}
+
+/*
+ * void I2CSimRegisters::Poke(uint8_t reg, uint8_t val)
+ *
+ * Description:
+ *   Sets a register value without going through the bus, as the
+ *   device itself would when, say, a new measurement is ready.
+ *
+ * Parameters:
+ *   reg - register address
+ *   val - register value
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimRegisters::Poke(uint8_t reg, uint8_t val)
+{
+    lock_guard<mutex> lck(mtx);
+    regs[reg] = val;
+}
+
+
+
+// I2CSimBus
+// ------------------------------------------------------------------
+
+/*
+ * I2CSimBus::I2CSimBus(const char* name)
+ *
+ * Description:
+ *   Constructor. Creates an empty bus.
+ *
+ * Parameters:
+ *   name - bus name, returned by Name() and used in exception
+ *          messages. Defaults to "i2c-sim".
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+I2CSimBus::I2CSimBus(const char* name)
+{
+    busname    = name;
+    nexthandle = 1;
+    sclhz      = 100000;
+    realtime   = false;
+    timing     = I2CSimTiming();
+
+    for (int i = 0; i < 128; i++)
+        devices[i] = nullptr;
+}
+
+/*
+ * int I2CSimBus::Slave(int handle)
+ *
+ * Description:
+ *   Returns the slave address set on a handle, -1 if none has
+ *   been set, or -2 if the handle is not open.
+ *
+ *   Assumes that the bus mutex is held.
+ *
+ * Parameters:
+ *   handle - the handle
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+int I2CSimBus::Slave(int handle)
+{
+    auto it = handles.find(handle);
+    if (it == handles.end())
+        return -2;
+
+    return it->second;
+}
+
+/*
+ * bool I2CSimBus::Message(struct i2c_msg& msg, bool restart, I2CSimDevice*& dev)
+ *
+ * Description:
+ *   Carries out one message: a START or repeated START, the
+ *   address byte, and the payload. Sets errno and returns false
+ *   on a NACK.
+ *
+ *   Assumes that the bus mutex is held.
+ *
+ * Parameters:
+ *   msg     - the message
+ *   restart - true if the message follows another message of the
+ *             same transaction
+ *   dev     - receives the addressed device, or nullptr if there
+ *             is no device at the address
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+bool I2CSimBus::Message(struct i2c_msg& msg, bool restart, I2CSimDevice*& dev)
+{
+    bool read = (msg.flags & I2C_M_RD) != 0;
+
+    if (restart)
+        timing.restarts++;
+    else
+        timing.starts++;
+    timing.addrbytes++;
+    timing.acks++;
+    timing.clocks += 1 + 9;
+
+    dev = devices[msg.addr & 0x7F];
+    if (dev == nullptr || !dev->Start(read))
+    {
+        errno = ENXIO;
+        return false;
+    }
+
+    timing.databytes += msg.len;
+    timing.acks      += msg.len;
+    timing.clocks    += 9 * msg.len;
+
+    if (read)
+    {
+        dev->Read(msg.buf, msg.len);
+    }
+    else if (!dev->Write(msg.buf, msg.len))
+    {
+        errno = EREMOTEIO;
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * void I2CSimBus::Stop(unsigned long clocks0)
+ *
+ * Description:
+ *   Ends a transaction with a STOP. In real-time mode, sleeps,
+ *   still holding the bus, for the wire time of the transaction.
+ *
+ *   Assumes that the bus mutex is held.
+ *
+ * Parameters:
+ *   clocks0 - the clock count when the transaction began
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimBus::Stop(unsigned long clocks0)
+{
+    timing.stops++;
+    timing.transactions++;
+    timing.clocks += 1;
+
+    if (realtime)
+    {
+        int saved = errno;
+        unsigned long usecs = (timing.clocks - clocks0) * 1000000UL / sclhz;
+        this_thread::sleep_for(chrono::microseconds(usecs));
+        errno = saved;
+    }
+}
+
+/*
+ * void I2CSimBus::Attach(uint8_t addr, I2CSimDevice* dev)
+ *
+ * Description:
+ *   Attaches a device model at an address, replacing any device
+ *   already there.
+ *
+ * Parameters:
+ *   addr - 7-bit device address
+ *   dev  - the device model
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimBus::Attach(uint8_t addr, I2CSimDevice* dev)
+{
+    lock_guard<mutex> lck(mtx);
+    devices[addr & 0x7F] = dev;
+}
+
+/*
+ * void I2CSimBus::Detach(uint8_t addr)
+ *
+ * Description:
+ *   Removes the device at an address. Later transfers to the
+ *   address are NACKed.
+ *
+ * Parameters:
+ *   addr - 7-bit device address
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimBus::Detach(uint8_t addr)
+{
+    lock_guard<mutex> lck(mtx);
+    devices[addr & 0x7F] = nullptr;
+}
+
+/*
+ * void I2CSimBus::SetClock(unsigned long hz)
+ *
+ * Description:
+ *   Sets the SCL clock rate used to convert clocks into bus time,
+ *   typically 100000, 400000, or 1000000. Defaults to 100 kHz.
+ *
+ * Parameters:
+ *   hz - SCL clock rate, Hz
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimBus::SetClock(unsigned long hz)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (hz > 0)
+        sclhz = hz;
+}
+
+/*
+ * void I2CSimBus::SetRealTime(bool enable)
+ *
+ * Description:
+ *   In real-time mode each transaction occupies the bus for its
+ *   wire time at the current SCL rate, as it would on hardware.
+ *
+ * Parameters:
+ *   enable - true to enable real-time mode
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimBus::SetRealTime(bool enable)
+{
+    lock_guard<mutex> lck(mtx);
+    realtime = enable;
+}
+
+/*
+ * I2CSimTiming I2CSimBus::GetTiming()
+ *
+ * Description:
+ *   Returns a copy of the wire-level counters.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+I2CSimTiming I2CSimBus::GetTiming()
+{
+    lock_guard<mutex> lck(mtx);
+    return timing;
+}
+
+/*
+ * void I2CSimBus::ResetTiming()
+ *
+ * Description:
+ *   Zeroes the wire-level counters.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+void I2CSimBus::ResetTiming()
+{
+    lock_guard<mutex> lck(mtx);
+    timing = I2CSimTiming();
+}
+
+/*
+ * double I2CSimBus::BusTime()
+ *
+ * Description:
+ *   Returns the time, in seconds, that the counted traffic would
+ *   occupy a real bus at the current SCL rate.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+double I2CSimBus::BusTime()
+{
+    lock_guard<mutex> lck(mtx);
+    return (double)timing.clocks / sclhz;
+}
+
+/*
+ * double I2CSimBus::Throughput()
+ *
+ * Description:
+ *   Returns the payload rate, in bytes per second, that the counted
+ *   traffic would reach on a fully loaded real bus at the current
+ *   SCL rate. Only message data bytes count as payload; address
+ *   bytes cost clocks but are not counted. A register address
+ *   written as data is not told apart from other data and counts.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+double I2CSimBus::Throughput()
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (timing.clocks == 0)
+        return 0.0;
+
+    return (double)timing.databytes * sclhz / timing.clocks;
+}
+
+/*
+ * const char* I2CSimBus::Name()
+ *
+ * Description:
+ *   Returns the bus name.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+const char* I2CSimBus::Name()
+{
+    return busname.c_str();
+}
+
+/*
+ * int I2CSimBus::Open()
+ *
+ * Description:
+ *   Issues a new handle with no slave address set.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+int I2CSimBus::Open()
+{
+    lock_guard<mutex> lck(mtx);
+
+    int handle = nexthandle++;
+    handles[handle] = -1;
+
+    return handle;
+}
+
+/*
+ * int I2CSimBus::Close(int handle)
+ *
+ * Description:
+ *   Releases a handle.
+ *
+ * Parameters:
+ *   handle - the handle
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+int I2CSimBus::Close(int handle)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (handles.erase(handle) == 0)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * int I2CSimBus::SetSlave(int handle, uint8_t addr)
+ *
+ * Description:
+ *   Sets the slave address used by Read and Write on a handle.
+ *   Like I2C_SLAVE, does not touch the bus.
+ *
+ * Parameters:
+ *   handle - the handle
+ *   addr   - 7-bit device address
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+int I2CSimBus::SetSlave(int handle, uint8_t addr)
+{
+    lock_guard<mutex> lck(mtx);
+
+    auto it = handles.find(handle);
+    if (it == handles.end())
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (addr > 0x7F)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    it->second = addr;
+    return 0;
+}
+
+/*
+ * int I2CSimBus::Read(int handle, uint8_t* data, int len)
+ *
+ * Description:
+ *   Reads from the slave set on a handle, as one transaction.
+ *   Returns len, or -1.
+ *
+ * Parameters:
+ *   handle - the handle
+ *   data   - a buffer to receive data
+ *   len    - the number of bytes to be read
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+int I2CSimBus::Read(int handle, uint8_t* data, int len)
+{
+    lock_guard<mutex> lck(mtx);
+
+    int slave = this->Slave(handle);
+    if (slave < 0)
+    {
+        errno = (slave == -2) ? EBADF : EINVAL;
+        return -1;
+    }
+
+    struct i2c_msg msg;
+    I2CSimDevice*  dev = nullptr;
+
+    msg.addr  = slave;
+    msg.flags = I2C_M_RD;
+    msg.len   = len;
+    msg.buf   = data;
+
+    unsigned long clocks0 = timing.clocks;
+    bool ok = this->Message(msg, false, dev);
+    if (dev != nullptr)
+        dev->Stop();
+    this->Stop(clocks0);
+
+    return ok ? len : -1;
+}
+
+/*
+ * int I2CSimBus::Write(int handle, const uint8_t* data, int len)
+ *
+ * Description:
+ *   Writes to the slave set on a handle, as one transaction.
+ *   Returns len, or -1.
+ *
+ * Parameters:
+ *   handle - the handle
+ *   data   - a buffer containing data to be written
+ *   len    - the number of bytes to be written
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+int I2CSimBus::Write(int handle, const uint8_t* data, int len)
+{
+    lock_guard<mutex> lck(mtx);
+
+    int slave = this->Slave(handle);
+    if (slave < 0)
+    {
+        errno = (slave == -2) ? EBADF : EINVAL;
+        return -1;
+    }
+
+    struct i2c_msg msg;
+    I2CSimDevice*  dev = nullptr;
+
+    msg.addr  = slave;
+    msg.flags = 0;
+    msg.len   = len;
+    msg.buf   = (uint8_t*)data;
+
+    unsigned long clocks0 = timing.clocks;
+    bool ok = this->Message(msg, false, dev);
+    if (dev != nullptr)
+        dev->Stop();
+    this->Stop(clocks0);
+
+    return ok ? len : -1;
+}
+
+/*
+ * int I2CSimBus::RdWr(int handle, struct i2c_msg* msgs, int nmsgs)
+ *
+ * Description:
+ *   Carries out a combined transaction: one START, a repeated START
+ *   before each further message, and one STOP. Stops at the first
+ *   NACK, as the i2c-dev adapter does. Returns nmsgs, or -1.
+ *
+ *   Like the BeagleBone Black's i2c-omap adapter, which sets
+ *   I2C_AQ_NO_ZERO_LEN, rejects zero-length messages with
+ *   EOPNOTSUPP before anything reaches the bus.
+ *
+ * Parameters:
+ *   handle - the handle
+ *   msgs   - the messages to be transferred
+ *   nmsgs  - the number of messages
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+int I2CSimBus::RdWr(int handle, struct i2c_msg* msgs, int nmsgs)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (this->Slave(handle) == -2)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (nmsgs <= 0 || nmsgs > I2C_RDWR_IOCTL_MAX_MSGS)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int i = 0; i < nmsgs; i++)
+    {
+        if (msgs[i].len == 0)
+        {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+    }
+
+    unsigned long clocks0 = timing.clocks;
+    bool          ok      = true;
+
+    addressed.clear();
+
+    for (int i = 0; i < nmsgs && ok; i++)
+    {
+        I2CSimDevice* dev = nullptr;
+
+        ok = this->Message(msgs[i], i > 0, dev);
+
+        if (dev != nullptr)
+        {
+            bool seen = false;
+            for (I2CSimDevice* d : addressed)
+                seen = seen || (d == dev);
+            if (!seen)
+                addressed.push_back(dev);
+        }
+    }
+
+    for (I2CSimDevice* d : addressed)
+        d->Stop();
+    this->Stop(clocks0);
+
+    return ok ? nmsgs : -1;
+}
+
+} // namespace bbbi2c
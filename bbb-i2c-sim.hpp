@@ -0,0 +1,208 @@
+/*
+ * bbb-i2c-sim.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Simulated I2C bus header. Lets an I2CBus run without
+ *    hardware, on any Linux host.
+ */
+
+#ifndef BBB_I2C_SIM_HPP_
+#define BBB_I2C_SIM_HPP_
+
+
+#include <linux/i2c.h>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "bbb-i2c.hpp"
+
+
+namespace bbbi2c
+{
+
+/*
+ * class I2CSimDevice
+ *
+ * Description:
+ *   A device model for an I2CSimBus.
+ *
+ *   The bus calls Start() when a START or repeated START is
+ *   addressed to the device, then Write() or Read() with the
+ *   message payload, and Stop() at the end of the transaction.
+ *   Returning false from Start() or Write() NACKs the address
+ *   or the data.
+ *
+ *   Calls are serialized by the bus.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+class I2CSimDevice
+{
+  public:
+    virtual ~I2CSimDevice ();
+
+    virtual bool Start ( bool read );
+    virtual bool Write ( const uint8_t* data, int len ) = 0;
+    virtual void Read  ( uint8_t* data, int len ) = 0;
+    virtual void Stop  ();
+
+}; // class I2CSimDevice
+
+
+/*
+ * class I2CSimRegisters : public I2CSimDevice
+ *
+ * Description:
+ *   A generic register-file device: 256 eight-bit registers and
+ *   an auto-incrementing register pointer, which is how most I2C
+ *   sensors, expanders, and PWM controllers behave.
+ *
+ *   The first byte written after a START sets the pointer. Any
+ *   further bytes are stored starting at the pointer. Reads
+ *   return registers starting at the pointer. The pointer
+ *   increments after every byte and wraps at 0xFF.
+ *
+ *   Peek() and Poke() give the test harness direct access to
+ *   the registers, bypassing the bus.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+class I2CSimRegisters : public I2CSimDevice
+{
+  protected:
+    std::mutex  mtx;             // Guards regs, against Peek and Poke.
+    uint8_t     regs[256];       // Register file.
+    uint8_t     ptr;             // Register pointer.
+    bool        addressing;      // Next written byte sets ptr.
+
+  public:
+    I2CSimRegisters ();
+
+    bool Start ( bool read );
+    bool Write ( const uint8_t* data, int len );
+    void Read  ( uint8_t* data, int len );
+
+    uint8_t Peek ( uint8_t reg );
+    void    Poke ( uint8_t reg, uint8_t val );
+
+}; // class I2CSimRegisters
+
+
+/*
+ * struct I2CSimTiming
+ *
+ * Description:
+ *   Wire-level counters kept by an I2CSimBus.
+ *
+ *   Every address byte and data byte costs nine SCL clocks: eight
+ *   bits and an ACK. START, repeated START, and STOP are each
+ *   charged one clock, which approximates their setup and hold
+ *   times (and, for STOP, the bus free time) at standard and fast
+ *   mode rates.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+struct I2CSimTiming
+{
+    unsigned long transactions;  // START ... STOP sequences.
+    unsigned long starts;        // STARTs.
+    unsigned long restarts;      // Repeated STARTs.
+    unsigned long stops;         // STOPs.
+    unsigned long addrbytes;     // Address bytes.
+    unsigned long databytes;     // Payload bytes, both directions.
+    unsigned long acks;          // ACK and NACK bits.
+    unsigned long clocks;        // Total SCL clocks.
+};
+
+
+/*
+ * class I2CSimBus : public I2CBackend
+ *
+ * Description:
+ *   An in-process simulated I2C bus.
+ *
+ *   Device models are attached at addresses. Handles behave like
+ *   i2c-dev file descriptors, each with its own slave address,
+ *   and errors are reported the way i2c-dev reports them: -1,
+ *   with errno set to ENXIO for a NACKed address, EREMOTEIO for
+ *   NACKed data, and EBADF for a bad handle.
+ *
+ *   The bus does not own its devices. A device must stay valid
+ *   until it is detached or the bus is destroyed.
+ *
+ *   A timing model counts what each transaction puts on the wire
+ *   (see I2CSimTiming) and converts it to bus time at the SCL
+ *   rate set by SetClock(). BusTime() and Throughput() then give
+ *   the time and payload rate a workload would need on real
+ *   hardware. With SetRealTime(true), each transaction also holds
+ *   the bus for its wire time, so that contention behaves as it
+ *   would on hardware.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-sim.hpp
+ */
+class I2CSimBus : public I2CBackend
+{
+  protected:
+    string               busname;        // Name used in messages.
+    std::mutex           mtx;            // Serializes the bus.
+    I2CSimDevice*        devices[128];   // Attached devices, by address.
+    std::map<int, int>   handles;        // Open handles and their slave addresses.
+    int                  nexthandle;     // Next handle to be issued.
+    unsigned long        sclhz;          // SCL clock rate, Hz.
+    bool                 realtime;       // Hold the bus for each transaction's wire time.
+    I2CSimTiming         timing;         // Wire-level counters.
+    std::vector<I2CSimDevice*> addressed;  // RdWr scratch, kept to avoid allocating.
+
+    int  Slave   ( int handle );
+    bool Message ( struct i2c_msg& msg, bool restart, I2CSimDevice*& dev );
+    void Stop    ( unsigned long clocks0 );
+
+  public:
+    I2CSimBus ( const char* name = "i2c-sim" );
+
+    void Attach ( uint8_t addr, I2CSimDevice* dev );
+    void Detach ( uint8_t addr );
+
+    void         SetClock    ( unsigned long hz );
+    void         SetRealTime ( bool enable );
+    I2CSimTiming GetTiming   ();
+    void         ResetTiming ();
+    double       BusTime     ();
+    double       Throughput  ();
+
+    const char* Name ();
+
+    int Open     ();
+    int Close    ( int handle );
+    int SetSlave ( int handle, uint8_t addr );
+    int Read     ( int handle, uint8_t* data, int len );
+    int Write    ( int handle, const uint8_t* data, int len );
+    int RdWr     ( int handle, struct i2c_msg* msgs, int nmsgs );
+
+}; // class I2CSimBus
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_SIM_HPP_ */
@@ -0,0 +1,906 @@
+/*
+ * bbb-i2c-uring.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Implements the shared-memory submission and completion rings.
+ */
+
+
+#include "bbb-i2c-uring.hpp"
+
+#include <atomic>            // atomic
+#include <chrono>            // milliseconds
+#include <errno.h>           // errno, ESRCH
+#include <fcntl.h>           // O_CREAT, O_EXCL, O_RDWR
+#include <limits.h>          // INT_MAX
+#include <linux/futex.h>     // FUTEX_WAIT, FUTEX_WAKE
+#include <linux/i2c-dev.h>   // I2C_RDWR_IOCTL_MAX_MSGS
+#include <mutex>             // mutex, lock_guard
+#include <signal.h>          // kill()
+#include <sstream>           // stringstream
+#include <stdint.h>          // uint8_t, uint32_t, uint64_t
+#include <string.h>          // memcpy
+#include <sys/mman.h>        // shm_open(), shm_unlink(), mmap(), munmap()
+#include <sys/stat.h>        // fstat(), fchmod()
+#include <sys/syscall.h>     // SYS_futex
+#include <thread>            // thread, this_thread
+#include <unistd.h>          // close(), ftruncate(), getpid(), syscall()
+#include <vector>            // vector
+
+
+using namespace std;
+
+namespace bbbi2c
+{
+
+/*
+ * static void FutexWait(atomic<uint32_t>& word, uint32_t val)
+ *
+ * Description:
+ *   Sleeps until woken through word, unless word no longer holds
+ *   val. The futex is not private, since the word lives in memory
+ *   shared between processes.
+ */
+static void FutexWait(atomic<uint32_t>& word, uint32_t val)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, val, nullptr, nullptr, 0);
+}
+
+/*
+ * static void FutexWake(atomic<uint32_t>& word, int n)
+ *
+ * Description:
+ *   Wakes up to n sleepers on word.
+ */
+static void FutexWake(atomic<uint32_t>& word, int n)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, n, nullptr, nullptr, 0);
+}
+
+
+// I2CUringServer Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CUringServer::I2CUringServer(I2CBus& i2cbus, const char* shmname, int nchannels, int mode)
+ *
+ * Description:
+ *   Constructor. Creates the ring segment, replacing any segment
+ *   of the same name, and starts the server thread.
+ *
+ *   Any process that can open the segment can drive the bus, so
+ *   the mode should grant access only to trusted users. It is set
+ *   exactly, regardless of the umask.
+ *
+ * Parameters:
+ *   i2cbus    - the bus to be served
+ *   shmname   - POSIX shared-memory name, such as "/bbb-i2c-ring-2"
+ *   nchannels - the most clients at a time. Defaults to 8.
+ *   mode      - permission bits of the segment. Defaults to 0600.
+ *
+ * Exceptions:
+ *   I2CException - the segment cannot be created.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+I2CUringServer::I2CUringServer(I2CBus& i2cbus, const char* shmname, int nchannels, int mode)
+    : bus(i2cbus)
+{
+    if (nchannels < 1)
+        nchannels = 1;
+
+    name     = shmname;
+    size     = sizeof(I2CUringSegment) + (nchannels - 1) * sizeof(I2CUringChannel);
+    stats    = I2CUringStats();
+    stopping = false;
+
+    shm_unlink(shmname);
+
+    void* p  = MAP_FAILED;
+    int   fd = shm_open(shmname, O_CREAT | O_EXCL | O_RDWR, mode);
+    if (fd >= 0)
+    {
+        fchmod(fd, mode);
+        if (ftruncate(fd, size) == 0)
+            p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+
+    if (p == MAP_FAILED)
+    {
+        shm_unlink(shmname);
+
+        stringstream ss;
+        ss << "Unable to create ring segment " << name;
+        I2CException iexc(ss.str(), "I2CUringServer::I2CUringServer(i2cbus, shmname, nchannels, mode)");
+        throw iexc;
+    }
+
+    // A new segment is zero-filled: every channel is free and empty.
+    seg        = static_cast<I2CUringSegment*>(p);
+    nchan      = nchannels;
+    seg->nchan = nchannels;
+    seg->magic.store(I2C_URING_MAGIC, memory_order_release);
+
+    heads.assign(nchannels, 0);
+    server = thread(&I2CUringServer::Run, this);
+}
+
+/*
+ * I2CUringServer::~I2CUringServer()
+ *
+ * Description:
+ *   Destructor. Stops the server thread and removes the segment.
+ *   Entries not yet taken are not carried out.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+I2CUringServer::~I2CUringServer()
+{
+    stopping = true;
+    seg->wake.fetch_add(1);
+    FutexWake(seg->wake, INT_MAX);
+    server.join();
+
+    munmap(seg, size);
+    shm_unlink(name.c_str());
+}
+
+
+// I2CUringServer Protected
+// ------------------------------------------------------------------
+
+/*
+ * void I2CUringServer::Idle()
+ *
+ * Description:
+ *   Sleeps until a client submits an entry.
+ *
+ *   The wake count is read, and the sleeping flag raised, before
+ *   the submission rings are checked one last time. A client that
+ *   submits after that check sees the flag and bumps the count, so
+ *   the futex wait either returns at once or is woken.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+void I2CUringServer::Idle()
+{
+    uint32_t v = seg->wake.load();
+    seg->sleeping.store(1);
+
+    bool work = stopping;
+    for (uint32_t c = 0; c < nchan && !work; c++)
+        work = seg->chan[c].sqtail.load() != heads[c];
+
+    if (!work)
+    {
+        {
+            lock_guard<mutex> lck(smtx);
+            stats.sleeps++;
+        }
+        FutexWait(seg->wake, v);
+    }
+
+    seg->sleeping.store(0);
+}
+
+/*
+ * void I2CUringServer::Post(I2CUringChannel& ch, uint32_t index, uint64_t user, int32_t status)
+ *
+ * Description:
+ *   Posts a completion to a channel.
+ *
+ * Parameters:
+ *   ch     - the channel
+ *   index  - the ring index of the completed entry
+ *   user   - the user value of the entry, as taken
+ *   status - an I2CBrokerStatus
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+void I2CUringServer::Post(I2CUringChannel& ch, uint32_t index, uint64_t user, int32_t status)
+{
+    uint32_t tail = ch.cqtail.load(memory_order_relaxed);
+    I2CCqe&  cqe  = ch.cq[tail & (I2C_URING_ENTRIES - 1)];
+
+    cqe.user   = user;
+    cqe.status = status;
+    cqe.index  = index;
+
+    ch.cqtail.store(tail + 1);
+}
+
+/*
+ * int32_t I2CUringServer::Exec(I2CBatch& batch)
+ *
+ * Description:
+ *   Carries out a batch on the bus and returns I2C_OK, or
+ *   I2C_ERR_XFER if the transfer failed.
+ *
+ * Parameters:
+ *   batch - the segments to be transferred
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+int32_t I2CUringServer::Exec(I2CBatch& batch)
+{
+    try
+    {
+        bus.Transfer(batch);
+    }
+    catch (I2CException&)
+    {
+        return I2C_ERR_XFER;
+    }
+
+    return I2C_OK;
+}
+
+/*
+ * void I2CUringServer::Run()
+ *
+ * Description:
+ *   Server thread. Takes entries from the channels in turn, up to
+ *   as many segments as fit into one I2C_RDWR ioctl, and carries
+ *   them out with Transfers whose segments point into the payload
+ *   slots. Then posts the completions, in submission order for
+ *   each channel, and wakes any client asleep waiting for one.
+ *
+ *   Consecutive replayable entries (see I2CBatch::Replayable())
+ *   share one Transfer; an entry that writes data goes out on its
+ *   own. If a shared Transfer fails, its entries are carried out
+ *   again one at a time, so that each completes with its own
+ *   status and one client cannot fail another's entries.
+ *
+ *   Entries that are malformed, including any with a zero-length
+ *   segment, complete with I2C_ERR_REQUEST. A channel whose client
+ *   has fallen a whole ring behind on its completions is passed
+ *   over until it catches up.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+void I2CUringServer::Run()
+{
+    struct Taken
+    {
+        uint32_t  c;        // Channel.
+        uint32_t  index;    // Ring index.
+        uint64_t  user;     // User value.
+        int32_t   status;   // Completion status.
+        size_t    slot;     // Segments, in batches.
+    };
+
+    const uint32_t mask = I2C_URING_ENTRIES - 1;
+
+    vector<Taken>    taken;
+    vector<I2CBatch> batches;
+    I2CBatch         merged;
+    uint32_t         rr = 0;
+
+    while (!stopping)
+    {
+        taken.clear();
+
+        int    nmsgs = 0;
+        bool   full  = false;
+        size_t used  = 0;
+
+        for (uint32_t k = 0; k < nchan && !full; k++)
+        {
+            uint32_t         c    = (rr + k) % nchan;
+            I2CUringChannel& ch   = seg->chan[c];
+            uint32_t         tail = ch.sqtail.load(memory_order_acquire);
+
+            while ( heads[c] != tail &&
+                    heads[c] - ch.cqhead.load(memory_order_acquire) < (uint32_t)I2C_URING_ENTRIES )
+            {
+                // The client can rewrite the entry at any time. Check
+                // and use a private copy only.
+                I2CSqe   sqe;
+                memcpy(&sqe, &ch.sq[heads[c] & mask], sizeof(sqe));
+
+                uint8_t* data  = ch.data[heads[c] & mask];
+                int      nsegs = sqe.nsegs;
+
+                if (nmsgs + nsegs > I2C_RDWR_IOCTL_MAX_MSGS && !taken.empty())
+                {
+                    full = true;
+                    break;
+                }
+
+                Taken t = { c, heads[c], sqe.user, I2C_OK, 0 };
+
+                // i2c-omap rejects zero-length messages, which would
+                // fail every entry sharing the ioctl.
+                int  total = 0;
+                bool empty = false;
+                for (int i = 0; i < nsegs && i < I2C_URING_MAXSEGS; i++)
+                {
+                    total += sqe.segs[i].len;
+                    empty |= sqe.segs[i].len == 0;
+                }
+
+                if (nsegs < 1 || nsegs > I2C_URING_MAXSEGS || total > I2C_URING_SLOTDATA || empty)
+                {
+                    t.status = I2C_ERR_REQUEST;
+                }
+                else
+                {
+                    if (used == batches.size())
+                        batches.emplace_back();
+
+                    I2CBatch& batch = batches[used];
+                    batch.Clear();
+                    t.slot = used++;
+
+                    // A write followed by a read of the same device is
+                    // bound as an Xfer, so that it counts as replayable.
+                    int pos = 0;
+                    for (int i = 0; i < nsegs; i++)
+                    {
+                        I2CSegment sg = sqe.segs[i];
+
+                        if ( !(sg.flags & I2C_SEG_READ) && i + 1 < nsegs &&
+                             (sqe.segs[i + 1].flags & I2C_SEG_READ) &&
+                             sqe.segs[i + 1].addr == sg.addr )
+                        {
+                            I2CSegment rd = sqe.segs[i + 1];
+
+                            batch.Xfer(data + pos, sg.len, data + pos + sg.len, rd.len, sg.addr);
+                            pos += sg.len + rd.len;
+                            i++;
+                        }
+                        else if (sg.flags & I2C_SEG_READ)
+                        {
+                            batch.Read(data + pos, sg.len, sg.addr);
+                            pos += sg.len;
+                        }
+                        else
+                        {
+                            batch.Write(data + pos, sg.len, sg.addr);
+                            pos += sg.len;
+                        }
+                    }
+                    nmsgs += nsegs;
+                }
+
+                taken.push_back(t);
+                heads[c]++;
+            }
+        }
+        rr++;
+
+        if (taken.empty())
+        {
+            this->Idle();
+            continue;
+        }
+
+        // Runs of replayable entries share a Transfer. Malformed
+        // entries have no segments and are stepped over.
+        unsigned long transfers = 0;
+        size_t        first     = 0;
+
+        while (first < taken.size())
+        {
+            if (taken[first].status != I2C_OK)
+            {
+                first++;
+                continue;
+            }
+
+            size_t last  = first + 1;
+            int    count = 1;
+
+            if (batches[taken[first].slot].Replayable())
+            {
+                while ( last < taken.size() &&
+                        ( taken[last].status != I2C_OK ||
+                          batches[taken[last].slot].Replayable() ) )
+                {
+                    if (taken[last].status == I2C_OK)
+                        count++;
+                    last++;
+                }
+            }
+
+            if (count > 1)
+            {
+                merged.Clear();
+                for (size_t i = first; i < last; i++)
+                {
+                    if (taken[i].status == I2C_OK)
+                        merged.Append(batches[taken[i].slot]);
+                }
+
+                transfers++;
+                if (this->Exec(merged) == I2C_OK)
+                {
+                    first = last;
+                    continue;
+                }
+            }
+
+            for (size_t i = first; i < last; i++)
+            {
+                if (taken[i].status == I2C_OK)
+                {
+                    transfers++;
+                    taken[i].status = this->Exec(batches[taken[i].slot]);
+                }
+            }
+
+            first = last;
+        }
+
+        unsigned long fails = 0;
+        for (auto& t : taken)
+        {
+            if (t.status != I2C_OK)
+                fails++;
+            this->Post(seg->chan[t.c], t.index, t.user, t.status);
+        }
+
+        for (uint32_t c = 0; c < nchan; c++)
+        {
+            I2CUringChannel& ch = seg->chan[c];
+
+            if (ch.sqhead.load(memory_order_relaxed) == heads[c])
+                continue;
+
+            ch.sqhead.store(heads[c], memory_order_release);
+            if (ch.cqwait.exchange(0) != 0)
+                FutexWake(ch.cqtail, 1);
+        }
+
+        lock_guard<mutex> lck(smtx);
+        stats.requests += taken.size();
+        stats.failures += fails;
+        stats.transfers += transfers;
+    }
+}
+
+
+// I2CUringServer Public
+// ------------------------------------------------------------------
+
+/*
+ * I2CUringStats I2CUringServer::GetStats()
+ *
+ * Description:
+ *   Returns a copy of the server counters. The bus's own transfer
+ *   statistics come from I2CBus::GetStats().
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+I2CUringStats I2CUringServer::GetStats()
+{
+    lock_guard<mutex> lck(smtx);
+    return stats;
+}
+
+
+
+// I2CUringClient Constructor, Destructor
+// ------------------------------------------------------------------
+
+/*
+ * I2CUringClient::I2CUringClient(const char* shmname)
+ *
+ * Description:
+ *   Constructor. Maps a server's ring segment and claims a free
+ *   channel. A channel whose owner process has died counts as
+ *   free. Its leftover entries are allowed to drain first, and
+ *   every completion they post is discarded, so that none can be
+ *   taken for one of this client's. If they do not drain within a
+ *   second, the channel is given back and the claim fails.
+ *
+ * Parameters:
+ *   shmname - the server's shared-memory name
+ *
+ * Exceptions:
+ *   I2CException - the segment cannot be mapped, every channel is
+ *                  taken, or the claimed channel does not drain.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+I2CUringClient::I2CUringClient(const char* shmname)
+{
+    struct stat st;
+    void*       p  = MAP_FAILED;
+    int         fd = shm_open(shmname, O_RDWR, 0);
+
+    if (fd >= 0)
+    {
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(I2CUringSegment))
+        {
+            size = st.st_size;
+            p    = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+    }
+
+    if (p == MAP_FAILED)
+    {
+        stringstream ss;
+        ss << "Unable to map ring segment " << shmname;
+        I2CException iexc(ss.str(), "I2CUringClient::I2CUringClient(shmname)");
+        throw iexc;
+    }
+
+    seg = static_cast<I2CUringSegment*>(p);
+    ch  = nullptr;
+
+    if (seg->magic.load(memory_order_acquire) == I2C_URING_MAGIC)
+    {
+        uint32_t pid = getpid();
+
+        for (uint32_t c = 0; c < seg->nchan && ch == nullptr; c++)
+        {
+            uint32_t owner = seg->chan[c].owner.load();
+
+            if (owner != 0 && (kill(owner, 0) == 0 || errno != ESRCH))
+                continue;
+            if (seg->chan[c].owner.compare_exchange_strong(owner, pid))
+                ch = &seg->chan[c];
+        }
+    }
+
+    if (ch == nullptr)
+    {
+        munmap(seg, size);
+
+        stringstream ss;
+        ss << "No free channel in ring segment " << shmname;
+        I2CException iexc(ss.str(), "I2CUringClient::I2CUringClient(shmname)");
+        throw iexc;
+    }
+
+    sqtail   = ch->sqtail.load();
+    prepared = 0;
+
+    // Consume leftover completions as they come, since the server
+    // stops taking entries from a channel whose completion ring is
+    // full. Completions are posted before sqhead moves past their
+    // entries, so once sqhead reaches sqtail every one has been seen.
+    for (int i = 0; ; i++)
+    {
+        bool drained = ch->sqhead.load() == sqtail;
+
+        cqhead = ch->cqtail.load();
+        ch->cqhead.store(cqhead);
+
+        if (drained)
+            break;
+
+        if (i == 1000)
+        {
+            ch->owner.store(0);
+            munmap(seg, size);
+
+            stringstream ss;
+            ss << "Channel in ring segment " << shmname << " did not drain";
+            I2CException iexc(ss.str(), "I2CUringClient::I2CUringClient(shmname)");
+            throw iexc;
+        }
+
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+/*
+ * I2CUringClient::~I2CUringClient()
+ *
+ * Description:
+ *   Destructor. Gives up the channel and unmaps the segment.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+I2CUringClient::~I2CUringClient()
+{
+    ch->owner.store(0);
+    munmap(seg, size);
+}
+
+
+// I2CUringClient Public
+// ------------------------------------------------------------------
+
+/*
+ * I2CSqe* I2CUringClient::GetSqe(uint64_t user)
+ *
+ * Description:
+ *   Returns the next free submission entry, emptied, or nullptr if
+ *   every entry is in flight or waiting to be seen.
+ *
+ * Parameters:
+ *   user - a value to be returned in the completion
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+I2CSqe* I2CUringClient::GetSqe(uint64_t user)
+{
+    if (sqtail + prepared - cqhead >= (uint32_t)I2C_URING_ENTRIES)
+        return nullptr;
+
+    I2CSqe* sqe = &ch->sq[(sqtail + prepared) & (I2C_URING_ENTRIES - 1)];
+
+    sqe->user  = user;
+    sqe->nsegs = 0;
+    sqe->used  = 0;
+
+    prepared++;
+    return sqe;
+}
+
+/*
+ * uint8_t* I2CUringClient::AddSegment(I2CSqe* sqe, uint8_t i2caddr, bool read, int len)
+ *
+ * Description:
+ *   Adds a segment to a prepared entry and returns the address of
+ *   its data in the payload slot, or nullptr if the entry has no
+ *   room left for it or len is less than 1. The caller writes
+ *   write data there; read data is found there after completion.
+ *
+ * Parameters:
+ *   sqe     - an entry from GetSqe(), not yet submitted
+ *   i2caddr - I2C address of the device
+ *   read    - true to read from the device, false to write
+ *   len     - the number of bytes, at least 1
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+uint8_t* I2CUringClient::AddSegment(I2CSqe* sqe, uint8_t i2caddr, bool read, int len)
+{
+    if (sqe->nsegs >= I2C_URING_MAXSEGS || len < 1 || sqe->used + len > I2C_URING_SLOTDATA)
+        return nullptr;
+
+    I2CSegment& sg = sqe->segs[sqe->nsegs];
+
+    sg.addr  = i2caddr;
+    sg.pad   = 0;
+    sg.flags = read ? I2C_SEG_READ : 0;
+    sg.len   = len;
+
+    uint8_t* data = ch->data[sqe - ch->sq] + sqe->used;
+
+    sqe->nsegs++;
+    sqe->used += len;
+
+    return data;
+}
+
+/*
+ * void I2CUringClient::Submit()
+ *
+ * Description:
+ *   Publishes every prepared entry to the server, and wakes the
+ *   server if, and only if, it is asleep.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+void I2CUringClient::Submit()
+{
+    if (prepared == 0)
+        return;
+
+    sqtail  += prepared;
+    prepared = 0;
+
+    ch->sqtail.store(sqtail);
+
+    if (seg->sleeping.load() != 0)
+    {
+        seg->wake.fetch_add(1);
+        FutexWake(seg->wake, 1);
+    }
+}
+
+/*
+ * I2CCqe* I2CUringClient::PeekCqe()
+ *
+ * Description:
+ *   Returns the next completion, or nullptr if there is none yet.
+ *   Never blocks or makes a system call.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+I2CCqe* I2CUringClient::PeekCqe()
+{
+    if (ch->cqtail.load(memory_order_acquire) == cqhead)
+        return nullptr;
+
+    return &ch->cq[cqhead & (I2C_URING_ENTRIES - 1)];
+}
+
+/*
+ * I2CCqe* I2CUringClient::WaitCqe()
+ *
+ * Description:
+ *   Returns the next completion, waiting for it if need be. Spins
+ *   briefly first, then sleeps on the completion ring, with a flag
+ *   raised so that the server knows to wake it.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+I2CCqe* I2CUringClient::WaitCqe()
+{
+    for (int i = 0; i < 200; i++)
+    {
+        I2CCqe* cqe = this->PeekCqe();
+        if (cqe != nullptr)
+            return cqe;
+    }
+
+    for (;;)
+    {
+        ch->cqwait.store(1);
+
+        uint32_t tail = ch->cqtail.load();
+        if (tail != cqhead)
+        {
+            ch->cqwait.store(0);
+            return this->PeekCqe();
+        }
+
+        FutexWait(ch->cqtail, tail);
+    }
+}
+
+/*
+ * uint8_t* I2CUringClient::CqeData(const I2CCqe* cqe)
+ *
+ * Description:
+ *   Returns the payload slot of a completed entry. The data of its
+ *   segments lies there in segment order. Valid until SeenCqe().
+ *
+ * Parameters:
+ *   cqe - a completion from PeekCqe() or WaitCqe()
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+uint8_t* I2CUringClient::CqeData(const I2CCqe* cqe)
+{
+    return ch->data[cqe->index & (I2C_URING_ENTRIES - 1)];
+}
+
+/*
+ * void I2CUringClient::SeenCqe()
+ *
+ * Description:
+ *   Consumes the next completion, freeing its entry for reuse.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+void I2CUringClient::SeenCqe()
+{
+    cqhead++;
+    ch->cqhead.store(cqhead, memory_order_release);
+}
+
+/*
+ * void I2CUringClient::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ *
+ * Description:
+ *   Write, repeated START, read, through the rings, waiting for the
+ *   result. To be used with no other entries in flight.
+ *
+ * Parameters:
+ *   odat    - data buffer that contains the data to be written
+ *   olen    - the number of bytes to be written
+ *   idat    - buffer that will receive data read from the device
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+void I2CUringClient::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+{
+    I2CSqe* sqe = this->GetSqe();
+    if (sqe == nullptr)
+    {
+        I2CException iexc("No free submission entry.", "I2CUringClient::Xfer(odat, olen, idat, ilen, i2caddr)");
+        throw iexc;
+    }
+
+    uint8_t* out = this->AddSegment(sqe, i2caddr, false, olen);
+    uint8_t* in  = this->AddSegment(sqe, i2caddr, true,  ilen);
+    if (out == nullptr || in == nullptr)
+    {
+        prepared--;
+        I2CException iexc("Transfer too large for a ring entry.", "I2CUringClient::Xfer(odat, olen, idat, ilen, i2caddr)");
+        throw iexc;
+    }
+
+    memcpy(out, odat, olen);
+    this->Submit();
+
+    I2CCqe* cqe    = this->WaitCqe();
+    int32_t status = cqe->status;
+
+    if (status == I2C_OK)
+        memcpy(idat, this->CqeData(cqe) + olen, ilen);
+    this->SeenCqe();
+
+    if (status != I2C_OK)
+    {
+        I2CException iexc("Transfer error.", "I2CUringClient::Xfer(odat, olen, idat, ilen, i2caddr)");
+        throw iexc;
+    }
+}
+
+} // namespace bbbi2c
@@ -0,0 +1,287 @@
+/*
+ * bbb-i2c-uring.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    Shared-memory submission and completion rings header. A
+ *    faster path than the broker socket for high-rate clients.
+ */
+
+#ifndef BBB_I2C_URING_HPP_
+#define BBB_I2C_URING_HPP_
+
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "bbb-i2c.hpp"
+#include "bbb-i2c-broker.hpp"
+
+
+namespace bbbi2c
+{
+
+const uint32_t I2C_URING_MAGIC    = 0x49325552;  // "I2UR"
+const int      I2C_URING_ENTRIES  = 32;          // Ring entries per channel.
+const int      I2C_URING_SLOTDATA = 256;         // Payload bytes per entry.
+const int      I2C_URING_MAXSEGS  = 8;           // Segments per entry.
+
+/*
+ * struct I2CSqe
+ *
+ * Description:
+ *   Submission queue entry: one transfer of up to
+ *   I2C_URING_MAXSEGS segments, carried out as one
+ *   I2CBus::Transfer. The data of each segment lies in the
+ *   entry's payload slot, in segment order; write data is placed
+ *   there by the client and read data by the server.
+ *
+ *   user  - returned unchanged in the completion
+ *   nsegs - the number of segments
+ *   used  - payload bytes taken by the segments so far
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+struct I2CSqe
+{
+    uint64_t    user;
+    uint16_t    nsegs;
+    uint16_t    used;
+    uint32_t    pad;
+    I2CSegment  segs[I2C_URING_MAXSEGS];
+};
+
+/*
+ * struct I2CCqe
+ *
+ * Description:
+ *   Completion queue entry.
+ *
+ *   user   - the user value of the submission
+ *   status - an I2CBrokerStatus
+ *   index  - the submission's ring index, which locates its
+ *            payload slot
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+struct I2CCqe
+{
+    uint64_t    user;
+    int32_t     status;
+    uint32_t    index;
+};
+
+/*
+ * struct I2CUringChannel
+ *
+ * Description:
+ *   One client's rings. The client owns sqtail and cqhead, the
+ *   server sqhead and cqtail; each pair sits on its own cache
+ *   line. cqwait is set by a client about to sleep on cqtail.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+struct I2CUringChannel
+{
+    alignas(64) std::atomic<uint32_t> owner;     // Owning process id, or 0.
+    alignas(64) std::atomic<uint32_t> sqtail;    // Next entry to be submitted.
+                std::atomic<uint32_t> cqhead;    // Next completion to be consumed.
+    alignas(64) std::atomic<uint32_t> sqhead;    // Next entry to be taken by the server.
+                std::atomic<uint32_t> cqtail;    // Next completion to be posted.
+                std::atomic<uint32_t> cqwait;    // Client is asleep on cqtail.
+
+    alignas(64) I2CSqe  sq[I2C_URING_ENTRIES];
+    I2CCqe              cq[I2C_URING_ENTRIES];
+    uint8_t             data[I2C_URING_ENTRIES][I2C_URING_SLOTDATA];
+};
+
+/*
+ * struct I2CUringSegment
+ *
+ * Description:
+ *   Layout of a ring segment. The server sleeps on wake when
+ *   every submission queue is empty, after setting sleeping.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+struct I2CUringSegment
+{
+    std::atomic<uint32_t>  magic;
+    uint32_t               nchan;
+    std::atomic<uint32_t>  wake;
+    std::atomic<uint32_t>  sleeping;
+    I2CUringChannel        chan[1];      // nchan channels.
+};
+
+
+/*
+ * struct I2CUringStats
+ *
+ * Description:
+ *   Running counters kept by an I2CUringServer.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+struct I2CUringStats
+{
+    unsigned long requests;      // Entries completed.
+    unsigned long failures;      // Entries not carried out.
+    unsigned long transfers;     // I2CBus::Transfer calls.
+    unsigned long sleeps;        // Times the server went idle.
+};
+
+
+/*
+ * class I2CUringServer
+ *
+ * Description:
+ *   Serves transfer requests from client processes through rings in
+ *   shared memory, on one bus.
+ *
+ *   The server creates a segment with a fixed number of channels,
+ *   one per client. A server thread takes entries from every
+ *   channel's submission ring, as many as fit into one I2C_RDWR
+ *   ioctl, and carries them out with I2CBus::Transfer, on batches
+ *   whose segments point straight into the payload slots, so that
+ *   data is never copied. It then posts a completion for each
+ *   entry.
+ *
+ *   When every submission ring is empty, the server sleeps on a
+ *   futex. Clients wake it only when it is asleep, and the server
+ *   wakes a client only when it is asleep waiting for a
+ *   completion, so that under steady load neither side makes a
+ *   system call per request.
+ *
+ *   Entries that only read, or write nothing but register
+ *   addresses, share one Transfer; an entry that writes data goes
+ *   out on its own. If a shared Transfer fails, its entries are
+ *   retried one at a time, so each completes with its own status.
+ *   Entries with a zero-length segment are rejected.
+ *
+ *   Every client can write the whole segment, so the server copies
+ *   each entry out of shared memory before checking it, and trusts
+ *   nothing else the segment holds. Who may be a client is set by
+ *   the segment's permission bits, by default owner only.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+class I2CUringServer
+{
+  protected:
+    I2CBus&                bus;        // The bus being served.
+    string                 name;       // Segment name.
+    size_t                 size;       // Segment size.
+    I2CUringSegment*       seg;        // Mapped segment.
+    uint32_t               nchan;      // Channels, kept out of client reach.
+    std::vector<uint32_t>  heads;      // Entries taken from each channel.
+    std::atomic<bool>      stopping;   // Server thread is to exit.
+    I2CUringStats          stats;      // Counters.
+    std::mutex             smtx;       // Guards stats.
+    std::thread            server;     // Server thread.
+
+    void    Idle ();
+    int32_t Exec ( I2CBatch& batch );
+    void    Post ( I2CUringChannel& ch, uint32_t index, uint64_t user, int32_t status );
+    void    Run  ();
+
+  public:
+    I2CUringServer ( I2CBus& i2cbus, const char* shmname, int nchannels = 8,
+                     int mode = 0600 );
+   ~I2CUringServer ();
+
+    I2CUringServer ( const I2CUringServer& ) = delete;
+    I2CUringServer& operator= ( const I2CUringServer& ) = delete;
+
+    I2CUringStats GetStats ();
+
+}; // class I2CUringServer
+
+
+/*
+ * class I2CUringClient
+ *
+ * Description:
+ *   A client's end of an I2CUringServer channel.
+ *
+ *   GetSqe() returns a free submission entry, and AddSegment() adds
+ *   a segment to it and returns where in shared memory the
+ *   segment's data lives: the caller writes write data there, and
+ *   finds read data there once the entry has completed. Submit()
+ *   publishes every entry prepared since the last Submit().
+ *
+ *   PeekCqe() returns the next completion, if any, without
+ *   blocking; WaitCqe() waits for one. CqeData() locates the
+ *   payload of a completed entry. SeenCqe() hands the entry back.
+ *
+ *   Xfer() does all of this for one write, repeated START, read.
+ *
+ *   A client is for one thread.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c-uring.hpp
+ */
+class I2CUringClient
+{
+  protected:
+    I2CUringSegment*   seg;        // Mapped segment.
+    size_t             size;       // Segment size.
+    I2CUringChannel*   ch;         // Claimed channel.
+    uint32_t           sqtail;     // Submitted entries.
+    uint32_t           prepared;   // Entries prepared but not submitted.
+    uint32_t           cqhead;     // Consumed completions.
+
+  public:
+    I2CUringClient ( const char* shmname );
+   ~I2CUringClient ();
+
+    I2CUringClient ( const I2CUringClient& ) = delete;
+    I2CUringClient& operator= ( const I2CUringClient& ) = delete;
+
+    I2CSqe*  GetSqe     ( uint64_t user = 0 );
+    uint8_t* AddSegment ( I2CSqe* sqe, uint8_t i2caddr, bool read, int len );
+    void     Submit     ();
+
+    I2CCqe*  PeekCqe ();
+    I2CCqe*  WaitCqe ();
+    uint8_t* CqeData ( const I2CCqe* cqe );
+    void     SeenCqe ();
+
+    void Xfer ( uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
+
+}; // class I2CUringClient
+
+} // namespace bbbi2c
+
+#endif /* BBB_I2C_URING_HPP_ */
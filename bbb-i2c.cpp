@@ -7,6 +7,7 @@
  *
  *  Revised:
  *    9 Sept, 2018
+ *   15 Oct,  2026
  *
  *  Description:
  *    Implements BeagleBone Black I2C bus and supporting classes.
@@ -15,17 +16,30 @@
 
 #include "bbb-i2c.hpp"
 
-#include <exception>         // exception
+#include <chrono>            // steady_clock, nanoseconds
+#include <condition_variable> // condition_variable
+#include <errno.h>           // errno, ENXIO, EREMOTEIO, EBUSY, EOWNERDEAD, EEXIST, ESRCH
+#include <exception>         // exception, exception_ptr
 #include <fcntl.h>           // open(), O_RDWR
 #include <iomanip>           // hex, uppercase, setfill(), setw()
-#include <linux/i2c.h>
-#include <linux/i2c-dev.h>   // I2C_SLAVE
+#include <limits.h>          // PATH_MAX
+#include <map>               // map
+#include <pthread.h>         // pthread_mutex_t, robust and process-shared mutexes
+#include <signal.h>          // kill()
+#include <linux/i2c.h>       // i2c_msg, I2C_M_RD
+#include <linux/i2c-dev.h>   // I2C_SLAVE, I2C_RDWR, i2c_rdwr_ioctl_data
+#include <memory>            // shared_ptr, make_shared
 #include <mutex>             // mutex, lock_guard
 #include <sstream>           // stringstream
 #include <stdint.h>          // int8_t, uint8_t
+#include <stdlib.h>          // realpath()
 #include <string>            // string
 #include <sys/ioctl.h>       // ioctl
-#include <unistd.h>          // close(), TEMP_FAILURE_RETRY
+#include <sys/mman.h>        // shm_open(), mmap(), munmap()
+#include <sys/stat.h>        // fstat(), fchmod()
+#include <thread>            // this_thread::sleep_for()
+#include <unistd.h>          // close(), getpid(), TEMP_FAILURE_RETRY
+#include <vector>            // vector
 
 
 using namespace std;
@@ -165,21 +179,2302 @@ I2CNotFoundException::I2CNotFoundException(const string& msg, const string& proc
 
 
 
+// I2CBackend
+// ------------------------------------------------------------------
+
+/*
+ * I2CBackend::~I2CBackend()
+ *
+ * Description:
+ *   Destructor.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBackend::~I2CBackend()
+{ }
+
+
+
+// I2CLinuxBackend
+// ------------------------------------------------------------------
+
+/*
+ * I2CLinuxBackend::I2CLinuxBackend(const char* bus)
+ *
+ * Description:
+ *   Constructor. Sets the bus file name.
+ *
+ * Parameters:
+ *   bus - The I2C bus file name.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CLinuxBackend::I2CLinuxBackend(const char* bus)
+{
+    busfile = bus;
+}
+
+/*
+ * const char* I2CLinuxBackend::Name()
+ *
+ * Description:
+ *   Returns the bus file name.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+const char* I2CLinuxBackend::Name()
+{
+    return busfile.c_str();
+}
+
+/*
+ * int I2CLinuxBackend::Open()
+ *
+ * Description:
+ *   Opens the bus file. Returns the file descriptor, or -1.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+int I2CLinuxBackend::Open()
+{
+    return ::open(busfile.c_str(), O_RDWR);
+}
+
+/*
+ * int I2CLinuxBackend::Close(int handle)
+ *
+ * Description:
+ *   Closes a file descriptor, retrying if interrupted.
+ *
+ * Parameters:
+ *   handle - the file descriptor
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+int I2CLinuxBackend::Close(int handle)
+{
+    errno = 0;
+
+    int closeresult = ::close(handle);
+    if (closeresult < 0)
+    {
+        if (errno == EINTR)
+        {
+            closeresult = TEMP_FAILURE_RETRY (::close(handle));
+        }
+    }
+
+    return closeresult;
+}
+
+/*
+ * int I2CLinuxBackend::SetSlave(int handle, uint8_t addr)
+ *
+ * Description:
+ *   Sets the slave address used by read() and write() on a file
+ *   descriptor (ioctl I2C_SLAVE).
+ *
+ * Parameters:
+ *   handle - the file descriptor
+ *   addr   - I2C address of the target device
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+int I2CLinuxBackend::SetSlave(int handle, uint8_t addr)
+{
+    return ioctl(handle, I2C_SLAVE, addr);
+}
+
+/*
+ * int I2CLinuxBackend::Read(int handle, uint8_t* data, int len)
+ *
+ * Description:
+ *   read() from the slave set on a file descriptor.
+ *
+ * Parameters:
+ *   handle - the file descriptor
+ *   data   - a buffer to receive data
+ *   len    - the number of bytes to be read
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+int I2CLinuxBackend::Read(int handle, uint8_t* data, int len)
+{
+    return ::read(handle, data, len);
+}
+
+/*
+ * int I2CLinuxBackend::Write(int handle, const uint8_t* data, int len)
+ *
+ * Description:
+ *   write() to the slave set on a file descriptor.
+ *
+ * Parameters:
+ *   handle - the file descriptor
+ *   data   - a buffer containing data to be written
+ *   len    - the number of bytes to be written
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+int I2CLinuxBackend::Write(int handle, const uint8_t* data, int len)
+{
+    return ::write(handle, data, len);
+}
+
+/*
+ * int I2CLinuxBackend::RdWr(int handle, struct i2c_msg* msgs, int nmsgs)
+ *
+ * Description:
+ *   Combined transfer of up to I2C_RDWR_IOCTL_MAX_MSGS messages
+ *   (ioctl I2C_RDWR). Returns the number of messages transferred.
+ *
+ * Parameters:
+ *   handle - the file descriptor
+ *   msgs   - the messages to be transferred
+ *   nmsgs  - the number of messages
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+int I2CLinuxBackend::RdWr(int handle, struct i2c_msg* msgs, int nmsgs)
+{
+    struct i2c_rdwr_ioctl_data xfer;
+
+    xfer.msgs  = msgs;
+    xfer.nmsgs = nmsgs;
+
+    return ioctl(handle, I2C_RDWR, &xfer);
+}
+
+
+
+// I2CBatch
+// ------------------------------------------------------------------
+
+/*
+ * I2CBatch::I2CBatch()
+ *
+ * Description:
+ *   Constructor. Creates an empty batch.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBatch::I2CBatch()
+{ }
+
+/*
+ * void I2CBatch::Read(uint8_t* data, int len, uint8_t i2caddr)
+ *
+ * Description:
+ *   Appends a read segment.
+ *
+ * Parameters:
+ *   data    - a buffer to receive data
+ *   len     - the number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBatch::Read(uint8_t* data, int len, uint8_t i2caddr)
+{
+    struct i2c_msg msg;
+
+    msg.addr  = i2caddr;
+    msg.flags = I2C_M_RD;
+    msg.len   = len;
+    msg.buf   = data;
+
+    msgs.push_back(msg);
+    joined.push_back(false);
+}
+
+/*
+ * void I2CBatch::Write(uint8_t* data, int len, uint8_t i2caddr)
+ *
+ * Description:
+ *   Appends a write segment.
+ *
+ * Parameters:
+ *   data    - a buffer containing data to be written
+ *   len     - the number of bytes to be written
+ *   i2caddr - I2C address of the target device
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBatch::Write(uint8_t* data, int len, uint8_t i2caddr)
+{
+    struct i2c_msg msg;
+
+    msg.addr  = i2caddr;
+    msg.flags = 0;
+    msg.len   = len;
+    msg.buf   = data;
+
+    msgs.push_back(msg);
+    joined.push_back(false);
+}
+
+/*
+ * void I2CBatch::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ *
+ * Description:
+ *   Appends a write segment followed by a read segment that is
+ *   bound to it, so that the two always go out in the same ioctl,
+ *   separated by a repeated START.
+ *
+ * Parameters:
+ *   odat    - data buffer that contains the data to be written
+ *   olen    - the number of bytes to be written
+ *   idat    - buffer that will receive data read from the device
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBatch::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+{
+    this->Write(odat, olen, i2caddr);
+    this->Read(idat, ilen, i2caddr);
+    joined.back() = true;
+}
+
+/*
+ * void I2CBatch::Append(I2CBatch& other)
+ *
+ * Description:
+ *   Appends all segments of another batch. The other batch is
+ *   left unchanged; both refer to the same data buffers.
+ *
+ * Parameters:
+ *   other - the batch to be appended
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBatch::Append(I2CBatch& other)
+{
+    msgs.insert(msgs.end(), other.msgs.begin(), other.msgs.end());
+    joined.insert(joined.end(), other.joined.begin(), other.joined.end());
+}
+
+/*
+ * void I2CBatch::Clear()
+ *
+ * Description:
+ *   Removes all segments, so that the batch can be reused.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBatch::Clear()
+{
+    msgs.clear();
+    joined.clear();
+}
+
+/*
+ * int I2CBatch::Size()
+ *
+ * Description:
+ *   Returns the number of segments (I2C messages) in the batch.
+ *   An Xfer counts as two.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+int I2CBatch::Size()
+{
+    return msgs.size();
+}
+
+/*
+ * bool I2CBatch::Replayable()
+ *
+ * Description:
+ *   Returns true if the batch may be carried out a second time
+ *   without side effects on the devices: every write segment in
+ *   it is the register address half of an Xfer. A batch that
+ *   writes data does not qualify, since a device may act on the
+ *   same write twice, or be busy with the first one.
+ *
+ *   Only replayable batches are merged with others, so that a
+ *   failed merged ioctl can be retried one batch at a time.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+bool I2CBatch::Replayable()
+{
+    for (size_t i = 0; i < msgs.size(); i++)
+    {
+        if ( !(msgs[i].flags & I2C_M_RD) &&
+             (i + 1 == msgs.size() || !joined[i + 1]) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+
+// I2CBusLock
+// ------------------------------------------------------------------
+
+/*
+ * struct I2CBusLock
+ *
+ * Description:
+ *   Layout of the shared-memory segment that holds a cross-process
+ *   bus lock. state is BUSLOCK_NONE in a new segment, the process
+ *   id of the process initializing the mutex while that is under
+ *   way, and BUSLOCK_READY once the mutex can be used.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+struct I2CBusLock
+{
+    atomic<uint32_t> state;
+    pthread_mutex_t  mtx;
+};
+
+const uint32_t BUSLOCK_NONE  = 0;
+const uint32_t BUSLOCK_READY = 0xFFFFFFFF;
+
+/*
+ * static I2CBusLock* MapBusLock(const string& name)
+ *
+ * Description:
+ *   Creates or opens a bus lock segment and maps it. Returns null
+ *   if that fails.
+ *
+ *   A segment this process created but could not size or map is
+ *   removed, so that it cannot block later attempts. So is an
+ *   existing segment that stays unsized for a second, which means
+ *   that its creator died before sizing it. A later call then
+ *   starts afresh.
+ */
+static I2CBusLock* MapBusLock(const string& name)
+{
+    void* p  = MAP_FAILED;
+    int   fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+
+    if (fd >= 0)
+    {
+        fchmod(fd, 0666);
+        if (ftruncate(fd, sizeof(I2CBusLock)) == 0)
+            p = mmap(nullptr, sizeof(I2CBusLock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (p == MAP_FAILED)
+            shm_unlink(name.c_str());
+    }
+    else if (errno == EEXIST)
+    {
+        fd = shm_open(name.c_str(), O_RDWR, 0);
+
+        // The creator may not have sized the segment yet.
+        struct stat st;
+        for (int i = 0; fd >= 0; i++)
+        {
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(I2CBusLock))
+            {
+                p = mmap(nullptr, sizeof(I2CBusLock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                break;
+            }
+            if (i == 1000)
+            {
+                shm_unlink(name.c_str());
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+
+    return (p == MAP_FAILED) ? nullptr : static_cast<I2CBusLock*>(p);
+}
+
+/*
+ * static void InitBusLock(I2CBusLock* bl)
+ *
+ * Description:
+ *   Returns once the mutex of a mapped bus lock is ready for use,
+ *   initializing it if no other process has.
+ *
+ *   Whichever process first moves the state from BUSLOCK_NONE to
+ *   its own process id initializes the mutex; the others wait. If
+ *   that process dies before it is done, the state is moved back
+ *   to BUSLOCK_NONE and another process takes over.
+ */
+static void InitBusLock(I2CBusLock* bl)
+{
+    uint32_t pid = getpid();
+
+    for (;;)
+    {
+        uint32_t st = bl->state.load(memory_order_acquire);
+
+        if (st == BUSLOCK_READY)
+            return;
+
+        if (st == BUSLOCK_NONE)
+        {
+            if (bl->state.compare_exchange_strong(st, pid))
+            {
+                pthread_mutexattr_t attr;
+
+                pthread_mutexattr_init(&attr);
+                pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+                pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+                pthread_mutex_init(&bl->mtx, &attr);
+                pthread_mutexattr_destroy(&attr);
+
+                bl->state.store(BUSLOCK_READY, memory_order_release);
+                return;
+            }
+            continue;
+        }
+
+        if (kill(st, 0) != 0 && errno == ESRCH)
+        {
+            bl->state.compare_exchange_strong(st, BUSLOCK_NONE);
+            continue;
+        }
+
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+
 // I2CBus Constructor, Destructor
 // ------------------------------------------------------------------
 
 /*
- * I2CBus::I2CBus(const char* bus)
+ * I2CBus::I2CBus(const char* bus, bool persist)
+ *
+ * Description:
+ *   Constructor.  Sets the bus file name. Initializes the I2C file
+ *   descriptor to -1.
+ *
+ *   Does not attempt to open the bus or even verify that the
+ *   bus exists.
+ *
+ * Parameters:
+ *   bus     - The I2C bus file name.
+ *   persist - true to keep the bus file open between transfers.
+ *             Defaults to false.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBus::I2CBus(const char* bus, bool persist)
+    : I2CBus(make_shared<I2CLinuxBackend>(bus), persist)
+{ }
+
+/*
+ * I2CBus::I2CBus(shared_ptr<I2CBackend> be, bool persist)
+ *
+ * Description:
+ *   Constructor. Uses the specified backend, for instance an
+ *   I2CSimBus, instead of i2c-dev.
+ *
+ * Parameters:
+ *   be      - the backend
+ *   persist - true to keep the backend handle open between
+ *             transfers. Defaults to false.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBus::I2CBus(shared_ptr<I2CBackend> be, bool persist)
+{
+    backend    = be;
+    file       = -1;
+    slaveaddr  = -1;
+    addrmode   = ADDR_SLAVE;
+    persistent = persist;
+    stats      = I2CStats();
+    combining  = false;
+    combiner   = false;
+
+    singleflight = false;
+    sfttl        = chrono::microseconds(0);
+
+    xlock = nullptr;
+}
+
+/*
+ * I2CBus::~I2CBus()
+ *
+ * Description:
+ *   Destructor. Ensures that file is closed before
+ *   going down the drain.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBus::~I2CBus()
+{
+    this->Close();
+
+    if (xlock != nullptr)
+        munmap(xlock, sizeof(I2CBusLock));
+}
+
+
+// I2CBus Registry
+// ------------------------------------------------------------------
+
+map<string, weak_ptr<I2CBus> > I2CBus::registry;
+mutex                          I2CBus::rmtx;
+
+/*
+ * shared_ptr<I2CBus> I2CBus::Get(const char* bus)
+ *
+ * Description:
+ *   Returns the process's shared bus for a bus file, creating it
+ *   as a persistent bus if there is none. Every caller that asks
+ *   for the same file gets the same object, and therefore the
+ *   same mutex, file descriptor, statistics and caches.
+ *
+ *   The file name is resolved first, so that a symbolic link and
+ *   its target name the same bus. The bus closes once the last
+ *   pointer to it is gone; a later Get() creates it anew.
+ *
+ *   Like the constructor, does not attempt to open the bus.
+ *
+ * Parameters:
+ *   bus - The I2C bus file name.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+shared_ptr<I2CBus> I2CBus::Get(const char* bus)
+{
+    char   resolved[PATH_MAX];
+    string key = (realpath(bus, resolved) != nullptr) ? resolved : bus;
+
+    lock_guard<mutex> lck(rmtx);
+
+    shared_ptr<I2CBus> sp = registry[key].lock();
+    if (sp == nullptr)
+    {
+        sp = make_shared<I2CBus>(bus, true);
+        registry[key] = sp;
+    }
+
+    return sp;
+}
+
+
+// I2CBus::Guard
+// ------------------------------------------------------------------
+
+/*
+ * I2CBus::Guard::Guard(I2CBus& i2cbus)
+ *
+ * Description:
+ *   Constructor. Acquires exclusive use of the bus.
+ *
+ *   The mutex is tried first. Only if it is already held does the
+ *   guard read the clock and block, so that the uncontended path
+ *   costs no more than a plain lock. The time spent waiting is
+ *   added to the bus statistics.
+ *
+ *   If the bus is process-shared, the cross-process lock is then
+ *   taken the same way. It is a robust futex-based mutex, so the
+ *   uncontended path makes no system call. If its owner died
+ *   holding it, the lock is marked consistent and taken over.
+ *
+ * Parameters:
+ *   i2cbus - the bus
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBus::Guard::Guard(I2CBus& i2cbus)
+    : bus(i2cbus)
+{
+    bool waited = false;
+    chrono::steady_clock::time_point t0;
+
+    if (!bus.mtx.try_lock())
+    {
+        waited = true;
+        t0     = chrono::steady_clock::now();
+        bus.mtx.lock();
+    }
+
+    if (bus.xlock != nullptr)
+    {
+        int rc = pthread_mutex_trylock(&bus.xlock->mtx);
+        if (rc == EBUSY)
+        {
+            if (!waited)
+            {
+                waited = true;
+                t0     = chrono::steady_clock::now();
+            }
+            rc = pthread_mutex_lock(&bus.xlock->mtx);
+        }
+
+        if (rc == EOWNERDEAD)
+        {
+            pthread_mutex_consistent(&bus.xlock->mtx);
+            bus.stats.lockrecoveries++;
+            rc = 0;
+        }
+
+        if (rc != 0)
+        {
+            bus.mtx.unlock();
+            I2CException iexc("Unable to lock the shared bus lock.", "I2CBus::Guard::Guard(i2cbus)");
+            throw iexc;
+        }
+    }
+
+    if (waited)
+    {
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+
+        bus.stats.lockwaits++;
+        bus.stats.lockwaitns += chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count();
+    }
+}
+
+/*
+ * I2CBus::Guard::~Guard()
+ *
+ * Description:
+ *   Destructor. Releases the bus.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBus::Guard::~Guard()
+{
+    if (bus.xlock != nullptr)
+        pthread_mutex_unlock(&bus.xlock->mtx);
+
+    bus.mtx.unlock();
+}
+
+
+// I2CBus::Session
+// ------------------------------------------------------------------
+
+/*
+ * I2CBus::Session::Session(I2CBus& i2cbus)
+ *
+ * Description:
+ *   Constructor. Acquires exclusive use of the bus, as the public
+ *   transfer functions do, and opens the bus file. Both are kept
+ *   until the session is destroyed.
+ *
+ *   Transfers made through the session bypass combining and
+ *   single-flight mode. Other threads that use the bus, including
+ *   through the bus's own functions, wait for the session to end.
+ *   Calling the bus's own transfer functions from the thread that
+ *   holds a session deadlocks.
+ *
+ * Parameters:
+ *   i2cbus - the bus
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBus::Session::Session(I2CBus& i2cbus)
+    : bus(i2cbus), lck(i2cbus)
+{
+    bus.OpenBus();
+}
+
+/*
+ * I2CBus::Session::~Session()
+ *
+ * Description:
+ *   Destructor. Closes the bus file, unless the bus is persistent,
+ *   discards single-flight results that the session's writes may
+ *   have made stale, and releases the bus.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CBus::Session::~Session()
+{
+    if (!bus.persistent)
+        bus.Close();
+
+    bus.Forget();
+}
+
+/*
+ * void I2CBus::Session::Read(uint8_t* data, int len, uint8_t i2caddr)
+ *
+ * Description:
+ *   Reads one or more bytes from the device at the specified
+ *   address, without locking.
+ *
+ * Parameters:
+ *   data    - a buffer to receive data
+ *   len     - the number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Session::Read(uint8_t* data, int len, uint8_t i2caddr)
+{
+    bus.LockedRead(data, len, i2caddr);
+    bus.stats.transactions++;
+}
+
+/*
+ * void I2CBus::Session::Write(uint8_t* data, int len, uint8_t i2caddr)
+ *
+ * Description:
+ *   Writes one or more bytes to the device at the specified
+ *   address, without locking.
+ *
+ * Parameters:
+ *   data    - a buffer containing data to be written
+ *   len     - the number of bytes to be written
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Session::Write(uint8_t* data, int len, uint8_t i2caddr)
+{
+    bus.LockedWrite(data, len, i2caddr);
+    bus.stats.transactions++;
+}
+
+/*
+ * void I2CBus::Session::Write(const string& dat, uint8_t i2caddr)
+ *
+ * Description:
+ *   Writes string data to the device at the specified address,
+ *   without locking.
+ *
+ * Parameters:
+ *   dat     - a string containing data to be written
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Session::Write(const string& dat, uint8_t i2caddr)
+{
+    bus.LockedWrite((uint8_t*)dat.data(), dat.size(), i2caddr);
+    bus.stats.transactions++;
+}
+
+/*
+ * void I2CBus::Session::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ *
+ * Description:
+ *   Write, repeated START, read, in one I2C_RDWR ioctl, without
+ *   locking.
+ *
+ * Parameters:
+ *   odat    - data buffer that contains the data to be written
+ *   olen    - the number of bytes to be written
+ *   idat    - buffer that will receive data read from the device
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Session::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+{
+    bus.LockedXfer(odat, olen, idat, ilen, i2caddr);
+    bus.stats.transactions++;
+}
+
+/*
+ * void I2CBus::Session::Transfer(I2CBatch& batch)
+ *
+ * Description:
+ *   Carries out every segment of a batch, in order, using as few
+ *   I2C_RDWR ioctls as possible, without locking.
+ *
+ * Parameters:
+ *   batch - the segments to be transferred
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Session::Transfer(I2CBatch& batch)
+{
+    bus.Exec(batch);
+    bus.stats.transactions++;
+}
+
+
+
+// I2CBus Protected
+// ------------------------------------------------------------------
+
+/*
+ * void I2CBus::OpenBus()
+ *
+ * Description:
+ *   Opens the bus file without selecting a slave address.
+ *
+ *   The bus file is opened only if it is not already open,
+ *   which is always the case for a persistent bus after the
+ *   first transfer.
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::OpenBus()
+{
+    if (file < 0)
+    {
+        file = backend->Open();
+        stats.syscalls++;
+        if (file < 0)
+        {
+            file = -1;
+            stats.errors++;
+            stringstream ss;
+            ss << "Unable to open I2C Bus file " << backend->Name();
+            I2CException iexc(ss.str(), "I2CBus::OpenBus()");
+            throw iexc;
+        }
+        stats.opens++;
+    }
+}
+
+/*
+ * void I2CBus::Open(uint8_t addr)
+ *
+ * Description:
+ *   Opens a connection to the device specified by the addr
+ *   parameter.
+ *
+ *   The I2C_SLAVE ioctl is skipped if the open file is already
+ *   set to the requested address.
+ *
+ * Parameters:
+ *   addr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Open(uint8_t addr)
+{
+    this->OpenBus();
+
+    if (slaveaddr == addr)
+        return;
+
+    int ioresult = backend->SetSlave(file, addr);
+    stats.syscalls++;
+    if (ioresult < 0)
+    {
+        this->Close();
+        stats.errors++;
+        stringstream ss;
+        ss << "Unable to find device address ";
+        ss << "0x" << hex << uppercase << setfill('0') << setw(2) << (unsigned int)addr;
+        I2CNotFoundException nfexc(ss.str(), "I2CBus::Open(addr)");
+        throw nfexc;
+    }
+
+    slaveaddr = addr;
+}
+
+/*
+ * void I2CBus::Close()
+ *
+ * Description:
+ *   Closes the bus connection (if it is open).
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Close()
+{
+    if (file != -1)
+    {
+        backend->Close(file);
+        stats.syscalls++;
+
+        file      = -1;
+        slaveaddr = -1;
+    }
+}
+
+/*
+ * void I2CBus::Release()
+ *
+ * Description:
+ *   Ends a successful transfer. Closes the bus connection unless
+ *   the bus is persistent, in which case the file stays open for
+ *   the next transfer.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Release()
+{
+    stats.transactions++;
+
+    if (!persistent)
+        this->Close();
+}
+
+
+/*
+ * void I2CBus::RdWr(struct i2c_msg* msgs, int nmsgs)
+ *
+ * Description:
+ *   Submits up to I2C_RDWR_IOCTL_MAX_MSGS messages as one I2C_RDWR
+ *   ioctl. The bus file must already be open. The file is closed
+ *   on failure.
+ *
+ * Parameters:
+ *   msgs  - the messages to be transferred
+ *   nmsgs - the number of messages
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::RdWr(struct i2c_msg* msgs, int nmsgs)
+{
+    int count = backend->RdWr(file, msgs, nmsgs);
+    stats.syscalls++;
+    if (count != nmsgs)
+    {
+        this->Close();
+        stats.errors++;
+        I2CException iexc("Transfer error.", "I2CBus::RdWr(msgs, nmsgs)");
+        throw iexc;
+    }
+}
+
+/*
+ * void I2CBus::Msg(uint8_t addr, uint16_t flags, uint8_t* buf, int len)
+ *
+ * Description:
+ *   Opens the bus file if necessary and transfers a single
+ *   I2C_RDWR message addressed to the specified device.
+ *
+ * Parameters:
+ *   addr  - I2C address of the target device
+ *   flags - i2c_msg flags: I2C_M_RD for a read, 0 for a write
+ *   buf   - data buffer
+ *   len   - the number of bytes to be transferred
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Msg(uint8_t addr, uint16_t flags, uint8_t* buf, int len)
+{
+    struct i2c_msg msg;
+
+    msg.addr  = addr;
+    msg.flags = flags;
+    msg.len   = len;
+    msg.buf   = buf;
+
+    this->OpenBus();
+    this->RdWr(&msg, 1);
+}
+
+/*
+ * void I2CBus::Exec(I2CBatch& batch)
+ *
+ * Description:
+ *   Carries out a batch, splitting it into as few I2C_RDWR ioctls
+ *   as I2C_RDWR_IOCTL_MAX_MSGS allows. A split never falls between
+ *   the halves of an Xfer segment.
+ *
+ *   Assumes that exclusive use of the bus has already been obtained.
+ *
+ * Parameters:
+ *   batch - the batch to be carried out
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Exec(I2CBatch& batch)
+{
+    int total = batch.msgs.size();
+    int first = 0;
+
+    if (total == 0)
+        return;
+
+    this->OpenBus();
+
+    while (first < total)
+    {
+        int last = first + I2C_RDWR_IOCTL_MAX_MSGS;
+        if (last >= total)
+            last = total;
+        else if (batch.joined[last])
+            last--;
+
+        this->RdWr(&batch.msgs[first], last - first);
+        first = last;
+    }
+}
+
+/*
+ * void I2CBus::LockedRead(uint8_t* data, int len, uint8_t addr)
+ *
+ * Description:
+ *   Reads one or more bytes from the device at the specified
+ *   address, by read() or, in ADDR_MSG mode, by one I2C_RDWR
+ *   message. The file is opened if necessary, and closed on
+ *   failure.
+ *
+ *   Assumes that exclusive use of the bus has already been obtained.
+ *
+ * Parameters:
+ *   data - a buffer to receive data
+ *   len  - the number of bytes to be read
+ *   addr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::LockedRead(uint8_t* data, int len, uint8_t addr)
+{
+    int recvd = 0;
+
+    if (addrmode == ADDR_MSG)
+    {
+        this->Msg(addr, I2C_M_RD, data, len);
+        return;
+    }
+
+    this->Open(addr);
+    recvd = backend->Read(file, data, len);
+    stats.syscalls++;
+
+    if (recvd != len)
+    {
+        this->Close();
+        stats.errors++;
+        I2CException iexc("Read length error.", "I2CBus::Read(data, len, addr)");
+        throw iexc;
+    }
+}
+
+/*
+ * void I2CBus::LockedWrite(uint8_t* data, int len, uint8_t addr)
+ *
+ * Description:
+ *   Writes one or more bytes to the device at the specified
+ *   address, by write() or, in ADDR_MSG mode, by one I2C_RDWR
+ *   message. The file is opened if necessary, and closed on
+ *   failure.
+ *
+ *   Assumes that exclusive use of the bus has already been obtained.
+ *
+ * Parameters:
+ *   data - a buffer containing data to be written
+ *   len  - the number of bytes to be written
+ *   addr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::LockedWrite(uint8_t* data, int len, uint8_t addr)
+{
+    int sent = 0;
+
+    if (addrmode == ADDR_MSG)
+    {
+        this->Msg(addr, 0, data, len);
+        return;
+    }
+
+    this->Open(addr);
+    sent = backend->Write(file, data, len);
+    stats.syscalls++;
+
+    if (sent != len)
+    {
+        this->Close();
+        stats.errors++;
+        I2CException iexc("Write length error.", "I2CBus::Write(data, len, addr)");
+        throw iexc;
+    }
+}
+
+/*
+ * void I2CBus::LockedXfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ *
+ * Description:
+ *   Writes and then reads, as two messages of one I2C_RDWR ioctl
+ *   with a repeated START between them. The file is opened if
+ *   necessary, and closed on failure.
+ *
+ *   Assumes that exclusive use of the bus has already been obtained.
+ *
+ * Parameters:
+ *   odat    - data buffer that contains the data to be written
+ *   olen    - the number of bytes to be written
+ *   idat    - buffer that will receive data read from the device
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::LockedXfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+{
+    struct i2c_msg msgs[2];
+
+    msgs[0].addr  = i2caddr;
+    msgs[0].flags = 0;
+    msgs[0].len   = olen;
+    msgs[0].buf   = odat;
+
+    msgs[1].addr  = i2caddr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len   = ilen;
+    msgs[1].buf   = idat;
+
+    this->OpenBus();
+    this->RdWr(msgs, 2);
+}
+
+/*
+ * void I2CBus::Combine(I2CBatch& batch)
+ *
+ * Description:
+ *   Carries out a batch in combining mode.
+ *
+ *   The batch is added to the list of waiting transfers. If no
+ *   other thread is combining, this thread becomes the combiner:
+ *   it takes the whole list, acquires the bus, carries out every
+ *   transfer on it with as few ioctls as possible, and wakes the
+ *   waiters. Otherwise the thread sleeps until a combiner has
+ *   carried out its batch, or until it can become the combiner
+ *   itself.
+ *
+ * Parameters:
+ *   batch - the segments to be transferred
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Combine(I2CBatch& batch)
+{
+    Waiter me;
+
+    me.batch = &batch;
+    me.done  = false;
+
+    unique_lock<mutex> clck(cmtx);
+    waiting.push_back(&me);
+
+    while (!me.done)
+    {
+        if (combiner)
+        {
+            ccv.wait(clck);
+            continue;
+        }
+
+        combiner = true;
+
+        vector<Waiter*> group;
+        group.swap(waiting);
+        clck.unlock();
+
+        // If the bus cannot be acquired, nothing in the group was
+        // carried out, and every waiter receives the exception.
+        exception_ptr exc;
+        try
+        {
+            Guard lck(*this);
+            this->ExecWaiters(group);
+        }
+        catch (...)
+        {
+            exc = current_exception();
+        }
+
+        clck.lock();
+        for (Waiter* w : group)
+        {
+            if (exc && !w->exc)
+                w->exc = exc;
+            w->done = true;
+        }
+        combiner = false;
+        ccv.notify_all();
+    }
+
+    if (me.exc)
+        rethrow_exception(me.exc);
+}
+
+/*
+ * void I2CBus::SharedXfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ *
+ * Description:
+ *   Carries out an Xfer in single-flight mode.
+ *
+ *   Requests are keyed by address, bytes written, and read length.
+ *   If an identical request is in flight, the caller waits for it
+ *   and copies its result (or its exception). If an identical
+ *   request completed successfully less than sfttl ago, its result
+ *   is copied at once. Otherwise the caller becomes the leader: it
+ *   records a new flight, carries out the Xfer, and publishes the
+ *   result to anyone who joined in the meantime. Recording a new
+ *   flight also discards any results older than sfttl.
+ *
+ * Parameters:
+ *   odat    - data buffer that contains the data to be written
+ *   olen    - the number of bytes to be written
+ *   idat    - buffer that will receive data read from the device
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::SharedXfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+{
+    string key;
+
+    key.reserve(olen + 3);
+    key.push_back((char)i2caddr);
+    key.push_back((char)(ilen & 0xFF));
+    key.push_back((char)(ilen >> 8));
+    key.append((const char*)odat, olen);
+
+    unique_lock<mutex> flck(fmtx);
+
+    auto it = flights.find(key);
+    if (it != flights.end())
+    {
+        shared_ptr<Flight> f = it->second;
+
+        if (!f->done)
+        {
+            fcv.wait(flck, [&f] { return f->done; });
+        }
+        else if (f->exc || chrono::steady_clock::now() - f->finished >= sfttl)
+        {
+            f.reset();
+            flights.erase(it);
+        }
+
+        if (f)
+        {
+            if (f->exc)
+                rethrow_exception(f->exc);
+
+            copy(f->result.begin(), f->result.end(), idat);
+            return;
+        }
+    }
+
+    // Results are only looked up by an identical request, so
+    // expired ones are swept out here, or the map would keep one
+    // per distinct request ever made.
+    if (sfttl.count() > 0)
+    {
+        auto now = chrono::steady_clock::now();
+
+        for (auto ex = flights.begin(); ex != flights.end(); )
+        {
+            if (ex->second->done && now - ex->second->finished >= sfttl)
+                ex = flights.erase(ex);
+            else
+                ++ex;
+        }
+    }
+
+    shared_ptr<Flight> mine = make_shared<Flight>();
+    mine->done = false;
+    flights[key] = mine;
+    flck.unlock();
+
+    try
+    {
+        this->BusXfer(odat, olen, idat, ilen, i2caddr);
+        mine->result.assign(idat, idat + ilen);
+    }
+    catch (...)
+    {
+        mine->exc = current_exception();
+    }
+
+    flck.lock();
+    mine->done     = true;
+    mine->finished = chrono::steady_clock::now();
+
+    // A flight that Forget() has removed stays out of the map, so
+    // that a result read before a write is never kept.
+    it = flights.find(key);
+    if ( (mine->exc || sfttl.count() == 0 || !singleflight) &&
+         it != flights.end() && it->second == mine )
+    {
+        flights.erase(it);
+    }
+
+    flck.unlock();
+    fcv.notify_all();
+
+    if (mine->exc)
+        rethrow_exception(mine->exc);
+}
+
+/*
+ * void I2CBus::Forget()
+ *
+ * Description:
+ *   Discards single-flight results, so that reads after a write
+ *   never see data from before it.
+ *
+ *   Flights still in progress are removed as well: their callers
+ *   still receive the result, but later requests do not join them,
+ *   and the result is not kept when they complete, since the read
+ *   may have gone out before the write.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Forget()
+{
+    if (!singleflight)
+        return;
+
+    lock_guard<mutex> flck(fmtx);
+
+    flights.clear();
+}
+
+/*
+ * bool I2CBus::Poll(uint8_t i2caddr, int reg, uint8_t mask, uint8_t expected, chrono::microseconds timeout)
+ *
+ * Description:
+ *   Polls a device until it is ready or the timeout expires. Returns
+ *   true if the device became ready.
+ *
+ *   The time each kind of poll took to succeed is remembered, as a
+ *   running average. The first probe is made at three quarters of
+ *   that time, and later probes follow at intervals that start at
+ *   one eighth of it and double up to one half. A poll with no
+ *   history starts probing at once, at 20 us intervals doubling up
+ *   to 10 ms.
+ *
+ *   The bus is released between probes. It is left open between
+ *   them and closed at the end, unless the bus is persistent.
+ *
+ * Parameters:
+ *   i2caddr  - I2C address of the device
+ *   reg      - status register address, or -1 to poll for an ACK
+ *   mask     - status bits to test
+ *   expected - the value of the masked bits when ready
+ *   timeout  - how long to keep polling
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+bool I2CBus::Poll(uint8_t i2caddr, int reg, uint8_t mask, uint8_t expected, chrono::microseconds timeout)
+{
+    typedef chrono::steady_clock clk;
+
+    const chrono::nanoseconds minstep = chrono::microseconds(20);
+
+    uint64_t key = ((uint64_t)i2caddr << 32) | ((uint64_t)(reg + 1) << 16) |
+                   ((uint64_t)mask << 8) | expected;
+
+    clk::time_point start    = clk::now();
+    clk::time_point deadline = start + timeout;
+    chrono::nanoseconds est(0);
+    {
+        Guard lck(*this);
+
+        auto it = polltimes.find(key);
+        if (it != polltimes.end())
+            est = it->second;
+    }
+
+    clk::time_point     next    = start;
+    chrono::nanoseconds step    = minstep;
+    chrono::nanoseconds maxstep = chrono::milliseconds(10);
+
+    if (est.count() > 0)
+    {
+        next    = start + est * 3 / 4;
+        step    = (est / 8 > minstep) ? est / 8 : minstep;
+        maxstep = (est / 2 > minstep) ? est / 2 : minstep;
+    }
+
+    bool ready = false;
+    for (;;)
+    {
+        if (next > deadline)
+            next = deadline;
+        this_thread::sleep_until(next);
+
+        ready = this->Probe(i2caddr, reg, mask, expected);
+        if (ready || clk::now() >= deadline)
+            break;
+
+        next = clk::now() + step;
+        step = (step * 2 < maxstep) ? step * 2 : maxstep;
+    }
+
+    Guard lck(*this);
+
+    if (ready)
+    {
+        chrono::nanoseconds took = clk::now() - start;
+        polltimes[key] = (est.count() > 0) ? (est + took) / 2 : took;
+    }
+
+    if (!persistent)
+        this->Close();
+
+    return ready;
+}
+
+/*
+ * bool I2CBus::Probe(uint8_t i2caddr, int reg, uint8_t mask, uint8_t expected)
+ *
+ * Description:
+ *   One poll, in the cheapest transaction that will do: a
+ *   one-byte read for an ACK poll, or a one-byte register read
+ *   otherwise. A NACK means not ready, and does not close the bus
+ *   or count as an error.
+ *
+ *   An ACK poll does not use a zero-length write, which would be
+ *   cheaper on the wire: the BeagleBone Black's i2c-omap adapter
+ *   does not support zero-length messages, and the kernel rejects
+ *   them with EOPNOTSUPP.
+ *
+ * Parameters:
+ *   i2caddr  - I2C address of the device
+ *   reg      - status register address, or -1 to poll for an ACK
+ *   mask     - status bits to test
+ *   expected - the value of the masked bits when ready
+ *
+ * Exceptions:
+ *   I2CException - the bus cannot be opened, or failed other than
+ *                  by a NACK.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+bool I2CBus::Probe(uint8_t i2caddr, int reg, uint8_t mask, uint8_t expected)
+{
+    uint8_t odat = (uint8_t)reg;
+    uint8_t idat = 0;
+    struct i2c_msg msgs[2];
+
+    msgs[0].addr  = i2caddr;
+    msgs[0].flags = 0;
+    msgs[0].len   = 1;
+    msgs[0].buf   = &odat;
+
+    msgs[1].addr  = i2caddr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len   = 1;
+    msgs[1].buf   = &idat;
+
+    // An ACK poll is the read message alone.
+    struct i2c_msg* first = (reg < 0) ? &msgs[1] : &msgs[0];
+    int             nmsgs = (reg < 0) ? 1 : 2;
+
+    Guard lck(*this);
+
+    this->OpenBus();
+
+    int count = backend->RdWr(file, first, nmsgs);
+    stats.syscalls++;
+    stats.transactions++;
+
+    if (count == nmsgs)
+        return reg < 0 || (idat & mask) == expected;
+
+    if (count < 0 && (errno == ENXIO || errno == EREMOTEIO))
+        return false;
+
+    this->Close();
+    stats.errors++;
+    I2CException iexc("Transfer error.", "I2CBus::Probe(i2caddr, reg, mask, expected)");
+    throw iexc;
+}
+
+/*
+ * void I2CBus::ExecWaiters(vector<Waiter*>& group)
+ *
+ * Description:
+ *   Carries out the batches of a group of waiters, packing
+ *   consecutive replayable batches into merged I2C_RDWR ioctls of
+ *   up to I2C_RDWR_IOCTL_MAX_MSGS messages. A batch that writes
+ *   data goes out on its own. If a merged ioctl fails, the
+ *   batches that took part in it are carried out again one by one
+ *   (see ExecEach()), so that each waiter receives only its own
+ *   result.
+ *
+ *   Assumes that exclusive use of the bus has already been obtained.
+ *
+ * Parameters:
+ *   group - the waiters
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::ExecWaiters(vector<Waiter*>& group)
+{
+    size_t first = 0;
+
+    while (first < group.size())
+    {
+        size_t last  = first + 1;
+        int    nmsgs = group[first]->batch->Size();
+
+        while ( last < group.size() &&
+                group[first]->batch->Replayable() &&
+                group[last]->batch->Replayable() &&
+                nmsgs + group[last]->batch->Size() <= I2C_RDWR_IOCTL_MAX_MSGS )
+        {
+            nmsgs += group[last]->batch->Size();
+            last++;
+        }
+
+        try
+        {
+            if (last - first == 1)
+            {
+                this->Exec(*group[first]->batch);
+            }
+            else
+            {
+                combined.Clear();
+                for (size_t i = first; i < last; i++)
+                    combined.Append(*group[i]->batch);
+                this->Exec(combined);
+            }
+            this->Release();
+        }
+        catch (...)
+        {
+            if (last - first == 1)
+                group[first]->exc = current_exception();
+            else
+                this->ExecEach(group, first, last);
+        }
+
+        first = last;
+    }
+}
+
+/*
+ * void I2CBus::ExecEach(vector<Waiter*>& group, size_t first, size_t last)
+ *
+ * Description:
+ *   Carries out the batches of waiters first to last - 1 one at a
+ *   time, after a merged ioctl for them has failed. Each waiter
+ *   receives its own exception, if any, so a transfer to a device
+ *   that is absent does not fail the transfers merged with it.
+ *
+ *   The failed ioctl gives no way to tell how far it got, so
+ *   segments that went out before the failure are sent again.
+ *   Only replayable batches are merged, so these are reads and
+ *   register address writes.
+ *
+ *   Assumes that exclusive use of the bus has already been obtained.
+ *
+ * Parameters:
+ *   group - the waiters
+ *   first - the first waiter of the failed ioctl
+ *   last  - one past its last waiter
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::ExecEach(vector<Waiter*>& group, size_t first, size_t last)
+{
+    for (size_t i = first; i < last; i++)
+    {
+        try
+        {
+            this->Exec(*group[i]->batch);
+            this->Release();
+        }
+        catch (...)
+        {
+            group[i]->exc = current_exception();
+        }
+    }
+}
+
+
+
+// I2CBus Public
+// ------------------------------------------------------------------
+
+/*
+ * I2CStats I2CBus::GetStats()
+ *
+ * Description:
+ *   Returns a copy of the bus transfer statistics.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CStats I2CBus::GetStats()
+{
+    lock_guard<mutex> lck(mtx);
+    return stats;
+}
+
+/*
+ * void I2CBus::ResetStats()
+ *
+ * Description:
+ *   Zeroes the bus transfer statistics.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::ResetStats()
+{
+    lock_guard<mutex> lck(mtx);
+    stats = I2CStats();
+}
+
+/*
+ * void I2CBus::SetProcessShared(bool enable)
+ *
+ * Description:
+ *   Enables or disables the cross-process bus lock.
+ *
+ *   The lock is a robust, process-shared pthread mutex in a POSIX
+ *   shared-memory segment named after the bus file, so "/dev/i2c-2"
+ *   is locked through "/bbb-i2c-lock-dev-i2c-2". Every I2CBus on the
+ *   same bus file that enables it, in any process, takes the lock
+ *   for each transfer, after its own mutex. The uncontended path
+ *   stays in user space. If a process dies holding the lock, the
+ *   next process to take it recovers it.
+ *
+ *   The segment is created by the first process to need it and is
+ *   not removed while usable, since other processes may be using
+ *   it. A segment left unsized, or with its mutex half set up, by
+ *   a process that failed or died is removed or taken over, so it
+ *   cannot lock every process out. Code that locks the public mtx
+ *   directly is not covered by the cross-process lock.
+ *
+ * Parameters:
+ *   enable - true to lock against other processes
+ *
+ * Exceptions:
+ *   I2CException - the shared-memory segment cannot be set up.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::SetProcessShared(bool enable)
+{
+    lock_guard<mutex> lck(mtx);
+
+    if (!enable)
+    {
+        if (xlock != nullptr)
+            munmap(xlock, sizeof(I2CBusLock));
+        xlock = nullptr;
+        return;
+    }
+
+    if (xlock != nullptr)
+        return;
+
+    string name = "/bbb-i2c-lock";
+    for (const char* c = backend->Name(); *c != '\0'; c++)
+        name += (*c == '/') ? '-' : *c;
+
+    // A failed first attempt may have removed a stale segment.
+    I2CBusLock* bl = MapBusLock(name);
+    if (bl == nullptr)
+        bl = MapBusLock(name);
+
+    if (bl == nullptr)
+    {
+        stringstream ss;
+        ss << "Unable to set up shared bus lock " << name;
+        I2CException iexc(ss.str(), "I2CBus::SetProcessShared(enable)");
+        throw iexc;
+    }
+
+    InitBusLock(bl);
+
+    xlock = bl;
+}
+
+/*
+ * void I2CBus::SetAddrMode(AddrMode mode)
+ *
+ * Description:
+ *   Selects how Read and Write address the target device.
+ *
+ *   ADDR_SLAVE - I2C_SLAVE ioctl, then read() or write(). The
+ *                ioctl is skipped while the address is unchanged.
+ *   ADDR_MSG   - A single I2C_RDWR message that carries the
+ *                address. One system call per transfer.
+ *
+ *   Xfer and Transfer always use I2C_RDWR.
+ *
+ * Parameters:
+ *   mode - the addressing mode
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::SetAddrMode(AddrMode mode)
+{
+    lock_guard<mutex> lck(mtx);
+    addrmode = mode;
+}
+
+/*
+ * void I2CBus::SetCombining(bool enable)
+ *
+ * Description:
+ *   Enables or disables combining mode.
+ *
+ *   In combining mode, Read, Write, Xfer, and Transfer calls that
+ *   arrive while the bus is busy are carried out together by one
+ *   thread, in one I2C_RDWR batch, instead of each taking its turn
+ *   with the mutex. Read and Write always go out as I2C_RDWR
+ *   messages in this mode, whatever the addressing mode.
+ *
+ *   Under contention, most callers then cost the bus no lock
+ *   handoff and no system call of their own. Only reads and
+ *   register reads are merged; a transfer that writes data goes
+ *   out on its own. If a merged transfer fails, its transfers are
+ *   retried one at a time, so that each caller receives only its
+ *   own result or exception.
+ *
+ * Parameters:
+ *   enable - true to enable combining
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::SetCombining(bool enable)
+{
+    combining = enable;
+}
+
+/*
+ * void I2CBus::SetSingleFlight(bool enable, chrono::microseconds ttl)
+ *
+ * Description:
+ *   Enables or disables single-flight mode for Xfer.
+ *
+ *   While an Xfer is in progress, an identical Xfer (same device
+ *   address, same bytes written, same read length) from another
+ *   thread does not go to the bus; it waits for the first one and
+ *   receives a copy of its result, or its exception.
+ *
+ *   With a nonzero ttl, a successful result is also handed to
+ *   identical requests that arrive within ttl of its completion.
+ *   Any Write, Transfer, or UpdateBits through this bus, or Write
+ *   through one of its I2CDevices, discards such results, so that
+ *   a read never returns data from before a write made through
+ *   the same bus. A read still in progress when the write is made
+ *   is not kept either.
+ *
+ *   Disabling single-flight mode discards every kept result.
+ *
+ * Parameters:
+ *   enable - true to enable single-flight mode
+ *   ttl    - how long a completed result may be reused. Defaults
+ *            to 0, meaning only requests in flight are shared.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::SetSingleFlight(bool enable, chrono::microseconds ttl)
+{
+    lock_guard<mutex> flck(fmtx);
+
+    sfttl        = ttl;
+    singleflight = enable;
+
+    if (!enable)
+        flights.clear();
+}
+
+/*
+ * void I2CBus::Read(uint8_t* data, int len, uint8_t addr)
+ *
+ * Description:
+ *   Acquires posession of the I2C bus and reads one or more bytes
+ *   from the device at the specified address.
+ *
+ * Parameters:
+ *   data - a buffer to receive data
+ *   len  - the number of bytes to be read
+ *   addr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Read(uint8_t* data, int len, uint8_t addr)
+{
+    if (combining)
+    {
+        I2CBatch batch;
+        batch.Read(data, len, addr);
+        this->Combine(batch);
+        return;
+    }
+
+    Guard lck(*this);
+
+    this->LockedRead(data, len, addr);
+    this->Release();
+}
+
+/*
+ * void I2CBus::Write(uint8_t* data, int len, uint8_t addr)
+ *
+ * Description:
+ *   Acquires posession of the I2C bus and writes one or more bytes
+ *   to the device at the specified address.
+ *
+ * Parameters:
+ *   data - a buffer containing data to be written
+ *   len  - the number of bytes to be written
+ *   addr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Write(uint8_t* data, int len, uint8_t addr)
+{
+    this->Forget();
+
+    if (combining)
+    {
+        I2CBatch batch;
+        batch.Write(data, len, addr);
+        this->Combine(batch);
+        return;
+    }
+
+    Guard lck(*this);
+
+    this->LockedWrite(data, len, addr);
+    this->Release();
+}
+
+/*
+ * void I2CBus::Write(const string& dat, uint8_t addr)
+ *
+ * Description:
+ *   Acquires posession of the I2C bus and writes string data to the
+ *   device at the specified address.
+ *
+ * Parameters:
+ *   dat  - a string containing data to be written
+ *   addr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Write(const string& dat, uint8_t addr)
+{
+    this->Forget();
+
+    if (combining)
+    {
+        I2CBatch batch;
+        batch.Write((uint8_t*)dat.data(), dat.size(), addr);
+        this->Combine(batch);
+        return;
+    }
+
+    Guard lck(*this);
+
+    this->LockedWrite((uint8_t*)dat.data(), dat.size(), addr);
+    this->Release();
+}
+
+/*
+ * void I2CBus::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ *
+ * Description:
+ *   Acquires posession of the I2C bus, writes one or more bytes to
+ *   the device, and then reads one or more bytes from the device at
+ *   the specified address.
+ *
+ *   The write and the read are submitted together in a single
+ *   I2C_RDWR ioctl, so the device sees one transaction with a
+ *   repeated START between the two halves rather than a STOP.
+ *   I2C_SLAVE is not needed, since each message carries the
+ *   device address.
+ *
+ *   In single-flight mode, identical concurrent Xfers share one
+ *   bus transfer (see SetSingleFlight()).
+ *
+ * Parameters:
+ *   odat    - data buffer that contains the data to be written
+ *   olen    - the number of bytes to be written
+ *   idat    - buffer that will receive data read from the device
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *   I2CNotFoundException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+{
+    if (singleflight)
+    {
+        this->SharedXfer(odat, olen, idat, ilen, i2caddr);
+        return;
+    }
+
+    this->BusXfer(odat, olen, idat, ilen, i2caddr);
+}
+
+/*
+ * void I2CBus::BusXfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ *
+ * Description:
+ *   Carries out an Xfer on the bus, by way of the combiner if
+ *   combining mode is enabled.
+ *
+ * Parameters:
+ *   odat    - data buffer that contains the data to be written
+ *   olen    - the number of bytes to be written
+ *   idat    - buffer that will receive data read from the device
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::BusXfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+{
+    if (combining)
+    {
+        I2CBatch batch;
+        batch.Xfer(odat, olen, idat, ilen, i2caddr);
+        this->Combine(batch);
+        return;
+    }
+
+    Guard lck(*this);
+
+    this->LockedXfer(odat, olen, idat, ilen, i2caddr);
+    this->Release();
+}
+
+/*
+ * void I2CBus::Measure(uint8_t* cmd, int clen, chrono::microseconds delay,
+ *                      uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
  *
  * Description:
- *   Constructor.  Sets the bus file name. Initializes the I2C file
- *   descriptor to -1.
+ *   Trigger, wait, read. Writes a command that starts a measurement,
+ *   waits out the conversion time, then reads the result, by Xfer
+ *   if olen is nonzero or by a plain Read otherwise.
  *
- *   Does not attempt to open the bus or even verify that the
- *   bus exists.
+ *   The bus is released during the wait, so other devices can use
+ *   it. Only the trigger and the read are atomic. Nothing keeps
+ *   other threads away from this device during the wait.
  *
  * Parameters:
- *   bus - The I2C bus file name.
+ *   cmd     - the trigger command
+ *   clen    - the number of bytes in cmd
+ *   delay   - the conversion time
+ *   odat    - bytes written before the read, such as a register
+ *             address. May be null if olen is 0.
+ *   olen    - the number of bytes in odat
+ *   idat    - buffer that will receive the result
+ *   ilen    - number of bytes to be read
+ *   i2caddr - I2C address of the target device
+ *
+ * Exceptions:
+ *   I2CException
  *
  * Namespace:
  *   bbbi2c
@@ -187,18 +2482,37 @@ I2CNotFoundException::I2CNotFoundException(const string& msg, const string& proc
  * Header File(s):
  *   bbb-i2c.hpp
  */
-I2CBus::I2CBus(const char* bus)
+void I2CBus::Measure(uint8_t* cmd, int clen, chrono::microseconds delay,
+                     uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
 {
-    busfile = bus;
-    file    = -1;
+    this->Write(cmd, clen, i2caddr);
+
+    this_thread::sleep_for(delay);
+
+    if (olen > 0)
+        this->Xfer(odat, olen, idat, ilen, i2caddr);
+    else
+        this->Read(idat, ilen, i2caddr);
 }
 
 /*
- * I2CBus::~I2CBus()
+ * void I2CBus::Transfer(I2CBatch& batch)
  *
  * Description:
- *   Destructor. Ensures that file is closed before
- *   going down the drain.
+ *   Acquires posession of the I2C bus and carries out every segment
+ *   of a batch, in order, using as few I2C_RDWR ioctls as possible.
+ *   With I2C_RDWR_IOCTL_MAX_MSGS or fewer messages, the batch is one
+ *   transaction: a single system call, with repeated STARTs between
+ *   segments and one STOP at the end.
+ *
+ *   If the batch must be split and a later ioctl fails, segments
+ *   from earlier ioctls will already have been carried out.
+ *
+ * Parameters:
+ *   batch - the segments to be transferred
+ *
+ * Exceptions:
+ *   I2CException
  *
  * Namespace:
  *   bbbi2c
@@ -206,24 +2520,244 @@ I2CBus::I2CBus(const char* bus)
  * Header File(s):
  *   bbb-i2c.hpp
  */
-I2CBus::~I2CBus()
+void I2CBus::Transfer(I2CBatch& batch)
 {
-    this->Close();
+    this->Forget();
+
+    if (combining)
+    {
+        this->Combine(batch);
+        return;
+    }
+
+    Guard lck(*this);
+
+    this->Exec(batch);
+    this->Release();
 }
 
+/*
+ * bool I2CBus::PollUntil(uint8_t i2caddr, uint8_t reg, uint8_t mask, uint8_t expected, chrono::microseconds timeout)
+ *
+ * Description:
+ *   Waits for status bits to reach a value, for instance a
+ *   data-ready flag. Returns true if they did, or false if the
+ *   timeout expired first.
+ *
+ *   Each probe is one repeated-start transaction that reads the
+ *   status register. Probing backs off from past completion
+ *   times, so a device that usually takes 8 ms is not polled
+ *   until about 6 ms in. A NACK counts as not ready.
+ *
+ * Parameters:
+ *   i2caddr  - I2C address of the device
+ *   reg      - status register address
+ *   mask     - status bits to test
+ *   expected - the value of the masked bits when ready
+ *   timeout  - how long to keep polling
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+bool I2CBus::PollUntil(uint8_t i2caddr, uint8_t reg, uint8_t mask, uint8_t expected, chrono::microseconds timeout)
+{
+    return this->Poll(i2caddr, reg, mask, expected, timeout);
+}
 
-// I2CBus Protected
+/*
+ * bool I2CBus::PollAck(uint8_t i2caddr, chrono::microseconds timeout)
+ *
+ * Description:
+ *   Waits for a device to acknowledge its address, for instance an
+ *   EEPROM finishing its write cycle. Returns true if it did, or
+ *   false if the timeout expired first.
+ *
+ *   Each probe is a one-byte read: a START, the address byte, one
+ *   data byte, and a STOP. The byte read is discarded. Probing
+ *   backs off as for PollUntil().
+ *
+ * Parameters:
+ *   i2caddr - I2C address of the device
+ *   timeout - how long to keep polling
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+bool I2CBus::PollAck(uint8_t i2caddr, chrono::microseconds timeout)
+{
+    return this->Poll(i2caddr, -1, 0, 0, timeout);
+}
+
+/*
+ * void I2CBus::UpdateBits(uint8_t i2caddr, uint8_t reg, uint8_t mask, uint8_t value)
+ *
+ * Description:
+ *   Acquires posession of the I2C bus and performs a read-modify-write
+ *   of the bits selected by mask in an eight-bit register:
+ *
+ *     reg = (reg & ~mask) | (value & mask)
+ *
+ *   The read is one repeated-start I2C_RDWR transaction. The write
+ *   is skipped if the bits already hold the value. The bus is held
+ *   throughout, so the update is atomic with respect to other users
+ *   of this I2CBus.
+ *
+ * Parameters:
+ *   i2caddr - I2C address of the target device
+ *   reg     - register address
+ *   mask    - the bits to be changed
+ *   value   - the new bit values, in place (not shifted)
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+void I2CBus::UpdateBits(uint8_t i2caddr, uint8_t reg, uint8_t mask, uint8_t value)
+{
+    this->Forget();
+
+    Guard lck(*this);
+
+    struct i2c_msg msgs[2];
+    uint8_t        buf[2];
+
+    buf[0] = reg;
+
+    msgs[0].addr  = i2caddr;
+    msgs[0].flags = 0;
+    msgs[0].len   = 1;
+    msgs[0].buf   = &buf[0];
+
+    msgs[1].addr  = i2caddr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len   = 1;
+    msgs[1].buf   = &buf[1];
+
+    this->OpenBus();
+    this->RdWr(msgs, 2);
+
+    uint8_t newval = (buf[1] & ~mask) | (value & mask);
+    if (newval != buf[1])
+    {
+        buf[1] = newval;
+        this->Msg(i2caddr, 0, buf, 2);
+    }
+
+    this->Release();
+}
+
+/*
+ * uint8_t I2CBus::ReadField(uint8_t i2caddr, uint8_t reg, uint8_t mask)
+ *
+ * Description:
+ *   Reads an eight-bit register and returns the bits selected by
+ *   mask, shifted down so that the lowest bit of the mask becomes
+ *   bit 0.
+ *
+ * Parameters:
+ *   i2caddr - I2C address of the target device
+ *   reg     - register address
+ *   mask    - the bits of the field
+ *
+ * Exceptions:
+ *   I2CException
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+uint8_t I2CBus::ReadField(uint8_t i2caddr, uint8_t reg, uint8_t mask)
+{
+    uint8_t val = 0;
+
+    this->Xfer(&reg, 1, &val, 1, i2caddr);
+
+    val &= mask;
+    while (mask != 0 && (mask & 0x01) == 0)
+    {
+        mask >>= 1;
+        val  >>= 1;
+    }
+
+    return val;
+}
+
+
+
+// I2CDevice
 // ------------------------------------------------------------------
 
 /*
- * void I2CBus::Open(uint8_t addr)
+ * I2CDevice::I2CDevice(I2CBus& i2cbus, uint8_t i2caddr)
  *
  * Description:
- *   Opens a connection to the device specified by the addr
- *   parameter.
+ *   Constructor. Binds the device to a bus and an address.
+ *
+ *   Like the bus, does not attempt to open anything. The file
+ *   is opened by the first transfer.
  *
  * Parameters:
- *   addr - I2C address of the target device
+ *   i2cbus  - the bus the device is attached to
+ *   i2caddr - I2C address of the device
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CDevice::I2CDevice(I2CBus& i2cbus, uint8_t i2caddr)
+    : bus(i2cbus)
+{
+    addr = i2caddr;
+    file = -1;
+}
+
+/*
+ * I2CDevice::~I2CDevice()
+ *
+ * Description:
+ *   Destructor. Closes the device file.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+I2CDevice::~I2CDevice()
+{
+    lock_guard<mutex> lck(bus.mtx);
+    this->Close();
+}
+
+/*
+ * void I2CDevice::Open()
+ *
+ * Description:
+ *   Opens the bus file and sets I2C_SLAVE to the device address,
+ *   unless that has already been done.
+ *
+ *   Assumes that the bus mutex is held.
  *
  * Exceptions:
  *   I2CException
@@ -235,34 +2769,45 @@ I2CBus::~I2CBus()
  * Header File(s):
  *   bbb-i2c.hpp
  */
-void I2CBus::Open(uint8_t addr)
+void I2CDevice::Open()
 {
-    file = ::open(busfile, O_RDWR);
+    if (file >= 0)
+        return;
+
+    file = bus.backend->Open();
+    bus.stats.syscalls++;
     if (file < 0)
     {
+        file = -1;
+        bus.stats.errors++;
         stringstream ss;
-        ss << "Unable to open I2C Bus file " << busfile;
-        I2CException iexc("I2CBus::Open(addr)", ss.str());
+        ss << "Unable to open I2C Bus file " << bus.backend->Name();
+        I2CException iexc(ss.str(), "I2CDevice::Open()");
         throw iexc;
     }
+    bus.stats.opens++;
 
-    int ioresult = ioctl(file, I2C_SLAVE, addr);
+    int ioresult = bus.backend->SetSlave(file, addr);
+    bus.stats.syscalls++;
     if (ioresult < 0)
     {
         this->Close();
+        bus.stats.errors++;
         stringstream ss;
         ss << "Unable to find device address ";
         ss << "0x" << hex << uppercase << setfill('0') << setw(2) << (unsigned int)addr;
-        I2CNotFoundException nfexc("I2CBus::Open(addr)", ss.str());
+        I2CNotFoundException nfexc(ss.str(), "I2CDevice::Open()");
         throw nfexc;
     }
 }
 
 /*
- * void I2CBus::Close()
+ * void I2CDevice::Close()
  *
  * Description:
- *   Closes the bus connection (if it is open).
+ *   Closes the device file (if it is open).
+ *
+ *   Assumes that the bus mutex is held.
  *
  * Namespace:
  *   bbbi2c
@@ -270,41 +2815,44 @@ void I2CBus::Open(uint8_t addr)
  * Header File(s):
  *   bbb-i2c.hpp
  */
-void I2CBus::Close()
+void I2CDevice::Close()
 {
-    errno = 0;
-
     if (file != -1)
     {
-        int closeresult = ::close(file);
-        if (closeresult < 0)
-        {
-            if (errno == EINTR)
-            {
-                TEMP_FAILURE_RETRY (::close(file));
-            }
-        }
+        bus.backend->Close(file);
+        bus.stats.syscalls++;
 
         file = -1;
     }
 }
 
-
-
-// I2CBus Public
-// ------------------------------------------------------------------
+/*
+ * uint8_t I2CDevice::Address()
+ *
+ * Description:
+ *   Returns the device address.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+uint8_t I2CDevice::Address()
+{
+    return addr;
+}
 
 /*
- * void I2CBus::Read(uint8_t* data, int len, uint8_t addr)
+ * void I2CDevice::Read(uint8_t* data, int len)
  *
  * Description:
  *   Acquires posession of the I2C bus and reads one or more bytes
- *   from the device at the specified address.
+ *   from the device.
  *
  * Parameters:
  *   data - a buffer to receive data
  *   len  - the number of bytes to be read
- *   addr - I2C address of the target device
  *
  * Exceptions:
  *   I2CException
@@ -316,34 +2864,35 @@ void I2CBus::Close()
  * Header File(s):
  *   bbb-i2c.hpp
  */
-void I2CBus::Read(uint8_t* data, int len, uint8_t addr)
+void I2CDevice::Read(uint8_t* data, int len)
 {
-    lock_guard<mutex> lck(mtx);
-
-    int recvd = 0;
+    I2CBus::Guard lck(bus);
 
-    this->Open(addr);
-    recvd = ::read(file, data, len);
-    this->Close();
+    this->Open();
+    int recvd = bus.backend->Read(file, data, len);
+    bus.stats.syscalls++;
 
     if (recvd != len)
     {
-        I2CException iexc("I2CBus::Read(data, len, addr)", "Read length error.");
+        this->Close();
+        bus.stats.errors++;
+        I2CException iexc("Read length error.", "I2CDevice::Read(data, len)");
         throw iexc;
     }
+
+    bus.stats.transactions++;
 }
 
 /*
- * void I2CBus::Write(uint8_t* data, int len, uint8_t addr)
+ * void I2CDevice::Write(uint8_t* data, int len)
  *
  * Description:
  *   Acquires posession of the I2C bus and writes one or more bytes
- *   to the device at the specified address.
+ *   to the device.
  *
  * Parameters:
  *   data - a buffer containing data to be written
  *   len  - the number of bytes to be written
- *   addr - I2C address of the target device
  *
  * Exceptions:
  *   I2CException
@@ -355,33 +2904,36 @@ void I2CBus::Read(uint8_t* data, int len, uint8_t addr)
  * Header File(s):
  *   bbb-i2c.hpp
  */
-void I2CBus::Write(uint8_t* data, int len, uint8_t addr)
+void I2CDevice::Write(uint8_t* data, int len)
 {
-    lock_guard<mutex> lck(mtx);
+    bus.Forget();
 
-    int sent = 0;
+    I2CBus::Guard lck(bus);
 
-    this->Open(addr);
-    sent = ::write(file, data, len);
-    this->Close();
+    this->Open();
+    int sent = bus.backend->Write(file, data, len);
+    bus.stats.syscalls++;
 
     if (sent != len)
     {
-        I2CException iexc("I2CBus::Write(data, len, addr)", "Write length error.");
+        this->Close();
+        bus.stats.errors++;
+        I2CException iexc("Write length error.", "I2CDevice::Write(data, len)");
         throw iexc;
     }
+
+    bus.stats.transactions++;
 }
 
 /*
- * void I2CBus::Write(const string& dat, uint8_t addr)
+ * void I2CDevice::Write(const string& dat)
  *
  * Description:
- *   Acquires posession of the I2C bus and writes string data to the
- *   device at the specified address.
+ *   Acquires posession of the I2C bus and writes string data to
+ *   the device.
  *
  * Parameters:
- *   dat  - a string containing data to be written
- *   addr - I2C address of the target device
+ *   dat - a string containing data to be written
  *
  * Exceptions:
  *   I2CException
@@ -393,38 +2945,24 @@ void I2CBus::Write(uint8_t* data, int len, uint8_t addr)
  * Header File(s):
  *   bbb-i2c.hpp
  */
-void I2CBus::Write(const string& dat, uint8_t addr)
+void I2CDevice::Write(const string& dat)
 {
-    lock_guard<mutex> lck(mtx);
-
-    int len  = dat.size();
-    int sent = 0;
-
-    this->Open(addr);
-    sent = ::write(file, dat.c_str(), len);
-    this->Close();
-
-    if (sent != len)
-    {
-        I2CException iexc("I2CBus::Write(dat, addr)", "Write length error.");
-        throw iexc;
-    }
+    this->Write((uint8_t*)dat.data(), dat.size());
 }
 
 /*
- * void I2CBus::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+ * void I2CDevice::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen)
  *
  * Description:
  *   Acquires posession of the I2C bus, writes one or more bytes to
- *   the device, and then reads one or more bytes from the device at
- *   the specified address.
+ *   the device, and then reads one or more bytes from the device,
+ *   as one I2C_RDWR repeated-start transaction.
  *
  * Parameters:
- *   odat    - data buffer that contains the data to be written
- *   olen    - the number of bytes to be written
- *   idat    - buffer that will receive data read from the device
- *   ilen    - number of bytes to be read
- *   i2caddr - I2C address of the target device
+ *   odat - data buffer that contains the data to be written
+ *   olen - the number of bytes to be written
+ *   idat - buffer that will receive data read from the device
+ *   ilen - number of bytes to be read
  *
  * Exceptions:
  *   I2CException
@@ -436,28 +2974,35 @@ void I2CBus::Write(const string& dat, uint8_t addr)
  * Header File(s):
  *   bbb-i2c.hpp
  */
-void I2CBus::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr)
+void I2CDevice::Xfer(uint8_t* odat, int olen, uint8_t* idat, int ilen)
 {
-    lock_guard<mutex> lck(mtx);
+    I2CBus::Guard lck(bus);
+
+    struct i2c_msg msgs[2];
+
+    msgs[0].addr  = addr;
+    msgs[0].flags = 0;
+    msgs[0].len   = olen;
+    msgs[0].buf   = odat;
+
+    msgs[1].addr  = addr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len   = ilen;
+    msgs[1].buf   = idat;
 
-    int count = 0;
+    this->Open();
+    int count = bus.backend->RdWr(file, msgs, 2);
+    bus.stats.syscalls++;
 
-    this->Open(i2caddr);
-    count = ::write(file, odat, olen);
-    if (count != olen)
+    if (count != 2)
     {
         this->Close();
-        I2CException iexc("I2CConnection::Xfer(odat, olen, idat, ilen, i2caddr)", "Write length error.");
+        bus.stats.errors++;
+        I2CException iexc("Transfer error.", "I2CDevice::Xfer(odat, olen, idat, ilen)");
         throw iexc;
     }
 
-    count = ::read(file, idat, ilen);
-    this->Close();
-    if (count != ilen)
-    {
-        I2CException iexc("I2CConnection::Xfer(odat, olen, idat, ilen, i2caddr)", "Read length error.");
-        throw iexc;
-    }
+    bus.stats.transactions++;
 }
 
 } // namespace bbbi2c
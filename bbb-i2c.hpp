@@ -13,10 +13,17 @@
 #define BBB_I2C_HPP_
 
 
+#include <atomic>
+#include <condition_variable>
 #include <exception>
+#include <chrono>
+#include <linux/i2c.h>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 
 using std::string;
@@ -70,15 +77,211 @@ class I2CNotFoundException : public I2CException
 };
 
 
+/*
+ * struct I2CStats
+ *
+ * Description:
+ *   Running counters kept by an I2CBus.
+ *
+ *   syscalls / transactions gives the number of system calls
+ *   spent per transfer, which is the figure of merit when
+ *   comparing persistent and non-persistent operation.
+ *
+ *   lockwaits counts transfers that found the bus busy, and
+ *   lockwaitns the total time they spent waiting for it.
+ *   Uncontended transfers are not timed.
+ *
+ *   lockrecoveries counts the times the cross-process lock was
+ *   taken over from a process that died holding it.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+struct I2CStats
+{
+    unsigned long transactions;  // Completed Read, Write, and Xfer calls.
+    unsigned long syscalls;      // open, ioctl, read, write, and close calls.
+    unsigned long opens;         // Bus file opens.
+    unsigned long errors;        // Failed transfers.
+    unsigned long lockwaits;     // Transfers that waited for the bus.
+    unsigned long lockwaitns;    // Total time spent waiting, ns.
+    unsigned long lockrecoveries; // Cross-process locks taken from dead owners.
+};
+
+
+/*
+ * class I2CBackend
+ *
+ * Description:
+ *   The interface between an I2CBus and whatever actually moves
+ *   the bits.
+ *
+ *   The operations mirror the i2c-dev system calls: Open returns
+ *   a handle (or -1), and the remaining operations take that
+ *   handle. Like the system calls, they report failure with a
+ *   negative return value rather than an exception, and Read,
+ *   Write, and RdWr return what read(), write(), and the I2C_RDWR
+ *   ioctl would return.
+ *
+ *   A backend may be shared by several buses and devices, so
+ *   implementations must be thread-safe.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+class I2CBackend
+{
+  public:
+    virtual ~I2CBackend ();
+
+    virtual const char* Name () = 0;
+
+    virtual int Open     () = 0;
+    virtual int Close    ( int handle ) = 0;
+    virtual int SetSlave ( int handle, uint8_t addr ) = 0;
+    virtual int Read     ( int handle, uint8_t* data, int len ) = 0;
+    virtual int Write    ( int handle, const uint8_t* data, int len ) = 0;
+    virtual int RdWr     ( int handle, struct i2c_msg* msgs, int nmsgs ) = 0;
+
+}; // class I2CBackend
+
+
+/*
+ * class I2CLinuxBackend : public I2CBackend
+ *
+ * Description:
+ *   The Linux i2c-dev backend. Handles are file descriptors on
+ *   the bus file, and each operation is one system call.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+class I2CLinuxBackend : public I2CBackend
+{
+  protected:
+    string busfile;              // I2C bus file name.
+
+  public:
+    I2CLinuxBackend ( const char* bus );
+
+    const char* Name ();
+
+    int Open     ();
+    int Close    ( int handle );
+    int SetSlave ( int handle, uint8_t addr );
+    int Read     ( int handle, uint8_t* data, int len );
+    int Write    ( int handle, const uint8_t* data, int len );
+    int RdWr     ( int handle, struct i2c_msg* msgs, int nmsgs );
+
+}; // class I2CLinuxBackend
+
+
+/*
+ * class I2CBatch
+ *
+ * Description:
+ *   A list of read and write segments to be carried out by
+ *   I2CBus::Transfer() as one combined I2C_RDWR transaction.
+ *
+ *   Segments may address different devices. The batch holds
+ *   pointers to the caller's buffers; nothing is copied, and
+ *   the buffers must stay valid until Transfer() returns.
+ *
+ *   A batch longer than I2C_RDWR_IOCTL_MAX_MSGS is split into
+ *   several ioctls. The write and read halves of an Xfer
+ *   segment are never split apart.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+class I2CBatch
+{
+  friend class I2CBus;
+  friend class I2CBrokerClient;
+
+  protected:
+    std::vector<struct i2c_msg> msgs;     // Segments, in order.
+    std::vector<bool>           joined;   // Segment must share an ioctl with its predecessor.
+
+  public:
+    I2CBatch ();
+
+    void Read  ( uint8_t* data, int len, uint8_t i2caddr );
+    void Write ( uint8_t* data, int len, uint8_t i2caddr );
+    void Xfer  ( uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
+
+    void Append     ( I2CBatch& other );
+    void Clear      ();
+    int  Size       ();
+    bool Replayable ();
+
+}; // class I2CBatch
+
+
 /*
  * class I2CBus
  *
  * Description:
  *   Represents a BeagleBone Black I2C bus.
  *
- *   The intention here is that I2C Read, Write, and Xfer
- *   functions should open a connection, do their business,
- *   and then close the connection on exit.
+ *   All I/O goes through an I2CBackend. A bus constructed
+ *   from a file name uses an I2CLinuxBackend on that file.
+ *
+ *   A bus is either non-persistent or persistent. On a
+ *   non-persistent bus, Read, Write, and Xfer open the bus
+ *   file, do their business, and close the file on exit. A
+ *   persistent bus opens the bus file once, on first use,
+ *   and keeps it open for the lifetime of the object. The
+ *   file is closed after an error and reopened by the next
+ *   transfer.
+ *
+ *   In ADDR_SLAVE mode (the default), Read and Write select
+ *   the device with an I2C_SLAVE ioctl, which is skipped when
+ *   the address is unchanged since the last transfer. In
+ *   ADDR_MSG mode they go out as single I2C_RDWR messages that
+ *   carry the address themselves, and I2C_SLAVE is never used.
+ *
+ *   In combining mode, a thread that finds the bus busy leaves
+ *   its transfer with the thread that holds it. That thread
+ *   carries out the waiting transfers in as few I2C_RDWR
+ *   batches as it can and wakes each waiter with its own
+ *   result. Transfers that write data go out on their own.
+ *
+ *   In single-flight mode, an Xfer that is identical to one
+ *   already in progress (same address, same bytes written, same
+ *   read length) waits for that one and shares its result instead
+ *   of going to the bus. An optional time-to-live lets identical
+ *   requests reuse a result that has only just completed.
+ *
+ *   PollUntil() and PollAck() wait for a device to become ready,
+ *   learning from past waits how long to hold off before polling.
+ *
+ *   With SetProcessShared(), the bus is also locked against other
+ *   processes using the same bus file, through a robust mutex in
+ *   shared memory.
+ *
+ *   Get() returns the one persistent bus of a process for a
+ *   given bus file, so that every part of a program that uses
+ *   it shares its lock, its file descriptor and its caches.
+ *   Two buses constructed directly on the same file do not
+ *   serialize with one another.
+ *
+ *   A Session holds the bus, with the file open, for as long as
+ *   it lives. Its Read, Write, Xfer, and Transfer functions do
+ *   not lock, so a multi-step sequence costs one lock and at most
+ *   one open.
  *
  * Namespace:
  *   bbbi2c
@@ -86,28 +289,210 @@ class I2CNotFoundException : public I2CException
  * Header File(s):
  *   bbb-i2c.hpp
  */
+struct I2CBusLock;
+
 class I2CBus
 {
+  friend class I2CDevice;
+
+  public:
+    enum AddrMode
+    {
+        ADDR_SLAVE,              // Select the device with I2C_SLAVE.
+        ADDR_MSG                 // Address each I2C_RDWR message.
+    };
+
   protected:
-    const char*  busfile;        // I2C bus file name.
-    int          file;           // File descriptor.
+    class Guard
+    {
+      protected:
+        I2CBus& bus;
 
-    void Open  ( uint8_t addr );
-    void Close ();
+      public:
+        Guard ( I2CBus& i2cbus );
+       ~Guard ();
+
+        Guard ( const Guard& ) = delete;
+        Guard& operator= ( const Guard& ) = delete;
+    };
+
+    struct Flight
+    {
+        bool                 done;       // Result (or error) is available.
+        std::vector<uint8_t> result;     // Bytes read.
+        std::exception_ptr   exc;        // Transfer error, if any.
+        std::chrono::steady_clock::time_point finished;  // Completion time.
+    };
+
+    struct Waiter
+    {
+        I2CBatch*           batch;   // Transfer left with the combiner.
+        bool                done;    // Set by the combiner, under cmtx.
+        std::exception_ptr  exc;     // Transfer error, if any.
+    };
+
+    std::shared_ptr<I2CBackend>  backend;   // Moves the bits.
+
+    int          file;           // Backend handle (file descriptor).
+    int          slaveaddr;      // Address last set by I2C_SLAVE, -1 if none.
+    AddrMode     addrmode;       // How Read and Write address the device.
+    bool         persistent;     // Keep the bus file open between transfers.
+    I2CStats     stats;          // Running counters.
+
+    std::atomic<bool>        combining;   // Combining mode enabled.
+    bool                     combiner;    // A thread is combining, guarded by cmtx.
+    std::vector<Waiter*>     waiting;     // Transfers waiting for a combiner.
+    std::mutex               cmtx;        // Guards combiner and waiting.
+    std::condition_variable  ccv;         // Signals finished combining passes.
+    I2CBatch                 combined;    // Merge buffer, guarded by mtx.
+
+    std::atomic<bool>        singleflight;  // Single-flight mode enabled.
+    std::chrono::microseconds sfttl;        // Result reuse period, guarded by fmtx.
+    std::map<string, std::shared_ptr<Flight> > flights;  // By request key, guarded by fmtx.
+    std::mutex               fmtx;          // Guards flights and sfttl.
+    std::condition_variable  fcv;           // Signals completed flights.
+
+    std::map<uint64_t, std::chrono::nanoseconds> polltimes;  // Learned ready times, guarded by mtx.
+
+    I2CBusLock*              xlock;       // Cross-process lock, or null. Guarded by mtx.
+
+    static std::map<string, std::weak_ptr<I2CBus> > registry;  // Buses from Get(), by file.
+    static std::mutex                               rmtx;      // Guards registry.
+
+    void OpenBus ();
+    void Open    ( uint8_t addr );
+    void Close   ();
+    void Release ();
+
+    void RdWr ( struct i2c_msg* msgs, int nmsgs );
+    void Msg  ( uint8_t addr, uint16_t flags, uint8_t* buf, int len );
+    void Exec ( I2CBatch& batch );
+
+    void LockedRead  ( uint8_t* data, int len, uint8_t addr );
+    void LockedWrite ( uint8_t* data, int len, uint8_t addr );
+    void LockedXfer  ( uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
+
+    void Combine     ( I2CBatch& batch );
+    void ExecWaiters ( std::vector<Waiter*>& group );
+    void ExecEach    ( std::vector<Waiter*>& group, size_t first, size_t last );
+
+    void BusXfer    ( uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
+    void SharedXfer ( uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
+    void Forget     ();
+
+    bool Poll  ( uint8_t i2caddr, int reg, uint8_t mask, uint8_t expected,
+                 std::chrono::microseconds timeout );
+    bool Probe ( uint8_t i2caddr, int reg, uint8_t mask, uint8_t expected );
 
   public:
+    class Session
+    {
+      protected:
+        I2CBus& bus;
+        Guard   lck;
+
+      public:
+        Session ( I2CBus& i2cbus );
+       ~Session ();
+
+        Session ( const Session& ) = delete;
+        Session& operator= ( const Session& ) = delete;
+
+        void Read  ( uint8_t* data, int len, uint8_t i2caddr );
+        void Write ( uint8_t* data, int len, uint8_t i2caddr );
+        void Write ( const string& dat, uint8_t i2caddr );
+        void Xfer  ( uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
+
+        void Transfer ( I2CBatch& batch );
+    };
+
     std::mutex mtx;
 
-    I2CBus ( const char* bus );
+    I2CBus ( const char* bus, bool persist = false );
+    I2CBus ( std::shared_ptr<I2CBackend> be, bool persist = false );
    ~I2CBus ();
 
+    static std::shared_ptr<I2CBus> Get ( const char* bus );
+
+    I2CStats GetStats   ();
+    void     ResetStats ();
+
+    void SetAddrMode     ( AddrMode mode );
+    void SetCombining    ( bool enable );
+    void SetSingleFlight ( bool enable,
+                           std::chrono::microseconds ttl = std::chrono::microseconds(0) );
+    void SetProcessShared ( bool enable );
+
     void Read  ( uint8_t* data, int len, uint8_t i2caddr );
     void Write ( uint8_t* data, int len, uint8_t i2caddr );
     void Write ( const string& dat, uint8_t i2caddr );
     void Xfer  ( uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
 
+    void Measure ( uint8_t* cmd, int clen, std::chrono::microseconds delay,
+                   uint8_t* odat, int olen, uint8_t* idat, int ilen, uint8_t i2caddr );
+
+    void Transfer ( I2CBatch& batch );
+
+    bool PollUntil ( uint8_t i2caddr, uint8_t reg, uint8_t mask, uint8_t expected,
+                     std::chrono::microseconds timeout );
+    bool PollAck   ( uint8_t i2caddr, std::chrono::microseconds timeout );
+
+    void    UpdateBits ( uint8_t i2caddr, uint8_t reg, uint8_t mask, uint8_t value );
+    uint8_t ReadField  ( uint8_t i2caddr, uint8_t reg, uint8_t mask );
+
 }; // class I2CBus
 
+
+/*
+ * class I2CDevice
+ *
+ * Description:
+ *   A handle on one device of an I2CBus.
+ *
+ *   The device keeps its own backend handle (for i2c-dev, a
+ *   file descriptor on the bus file), opened on first use
+ *   with I2C_SLAVE already set to the device address, and
+ *   keeps it until destroyed or until a transfer fails.
+ *   Read, Write, and Xfer therefore take no address
+ *   parameter and never issue I2C_SLAVE.
+ *
+ *   Transfers lock the bus mutex, so they serialize with
+ *   transfers made through the bus and through other devices.
+ *   System calls are counted in the bus statistics, and Write
+ *   discards results kept by the bus in single-flight mode.
+ *
+ * Namespace:
+ *   bbbi2c
+ *
+ * Header File(s):
+ *   bbb-i2c.hpp
+ */
+class I2CDevice
+{
+  protected:
+    I2CBus&  bus;                // The bus the device lives on.
+    uint8_t  addr;               // Device address.
+    int      file;               // Backend handle, bound to addr.
+
+    void Open  ();
+    void Close ();
+
+  public:
+    I2CDevice ( I2CBus& i2cbus, uint8_t i2caddr );
+   ~I2CDevice ();
+
+    I2CDevice ( const I2CDevice& ) = delete;
+    I2CDevice& operator= ( const I2CDevice& ) = delete;
+
+    uint8_t Address ();
+
+    void Read  ( uint8_t* data, int len );
+    void Write ( uint8_t* data, int len );
+    void Write ( const string& dat );
+    void Xfer  ( uint8_t* odat, int olen, uint8_t* idat, int ilen );
+
+}; // class I2CDevice
+
 } // namespace bbbi2c
 
 #endif /* BBB_I2C_HPP_ */
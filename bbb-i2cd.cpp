@@ -0,0 +1,162 @@
+/*
+ * bbb-i2cd.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: JSRagman
+ *
+ *  Description:
+ *    I2C broker daemon. Owns the I2C buses of the board and serves
+ *    transfer requests from other processes, which connect with
+ *    I2CBrokerClient.
+ *
+ *    Usage:
+ *      bbb-i2cd [-s socket] [-m mode] busno:busfile ...
+ *
+ *    For example:
+ *      bbb-i2cd -s /run/bbb-i2cd.sock -m 0660 1:/dev/i2c-1 2:/dev/i2c-2
+ *
+ *    The socket mode is given in octal and defaults to 0600, so
+ *    that only the daemon's own user can connect. Bus numbers run
+ *    from 0 to 255.
+ *
+ *    SIGINT or SIGTERM stops the daemon, which then prints the
+ *    request and transfer counters of each bus.
+ */
+
+
+#include <iostream>          // cout, cerr, endl
+#include <memory>            // shared_ptr
+#include <signal.h>          // sigaction(), SIGINT, SIGTERM
+#include <stdlib.h>          // strtol(), strtoul()
+#include <string.h>          // strchr(), strcmp()
+#include <vector>            // vector
+
+#include "bbb-i2c.hpp"
+#include "bbb-i2c-broker.hpp"
+
+
+using namespace std;
+using namespace bbbi2c;
+
+
+static I2CBroker* broker = nullptr;
+
+/*
+ * static void OnSignal(int sig)
+ *
+ * Description:
+ *   SIGINT and SIGTERM handler. Asks the broker to stop.
+ */
+static void OnSignal(int sig)
+{
+    (void)sig;
+
+    if (broker != nullptr)
+        broker->Stop();
+}
+
+/*
+ * int main(int argc, char* argv[])
+ *
+ * Description:
+ *   Parses the command line, puts each bus under a broker, and
+ *   serves until signalled.
+ */
+int main(int argc, char* argv[])
+{
+    const char* sockpath = "/run/bbb-i2cd.sock";
+    int         sockmode = 0600;
+    int         first    = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-s") == 0)
+        {
+            sockpath = argv[first + 1];
+        }
+        else if (strcmp(argv[first], "-m") == 0)
+        {
+            char* end;
+            long  mode = strtol(argv[first + 1], &end, 8);
+            if (*end != '\0' || end == argv[first + 1] || mode < 0 || mode > 0777)
+            {
+                cerr << "bbb-i2cd: invalid socket mode " << argv[first + 1] << endl;
+                return 2;
+            }
+            sockmode = mode;
+        }
+        else
+        {
+            break;
+        }
+        first += 2;
+    }
+
+    if (first >= argc)
+    {
+        cerr << "usage: bbb-i2cd [-s socket] [-m mode] busno:busfile ..." << endl;
+        return 2;
+    }
+
+    try
+    {
+        I2CBroker                    brk(sockpath, sockmode);
+        vector<uint8_t>              busnos;
+        vector< shared_ptr<I2CBus> > buses;
+
+        for (int i = first; i < argc; i++)
+        {
+            const char* colon = strchr(argv[i], ':');
+            if (colon == nullptr)
+            {
+                cerr << "bbb-i2cd: expected busno:busfile, got " << argv[i] << endl;
+                return 2;
+            }
+
+            char*         end;
+            unsigned long busno = strtoul(argv[i], &end, 10);
+            if (end != colon || end == argv[i] || busno > 255)
+            {
+                cerr << "bbb-i2cd: invalid bus number in " << argv[i] << endl;
+                return 2;
+            }
+
+            auto bus = I2CBus::Get(colon + 1);
+
+            brk.AddBus(busno, bus);
+            busnos.push_back(busno);
+            buses.push_back(bus);
+        }
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = OnSignal;
+        sigaction(SIGINT,  &sa, nullptr);
+        sigaction(SIGTERM, &sa, nullptr);
+
+        broker = &brk;
+        brk.Run();
+        broker = nullptr;
+
+        for (size_t i = 0; i < busnos.size(); i++)
+        {
+            I2CBrokerStats st = brk.GetStats(busnos[i]);
+            I2CStats       bs = buses[i]->GetStats();
+
+            cout << "bus "           << (int)busnos[i]
+                 << ": requests "     << st.requests
+                 << ", failures "     << st.failures
+                 << ", segments "     << st.segments
+                 << ", bytes "        << st.bytes
+                 << ", transactions " << bs.transactions
+                 << ", syscalls "     << bs.syscalls << endl;
+        }
+    }
+    catch (I2CException& iexc)
+    {
+        cerr << "bbb-i2cd: " << iexc.who() << ": " << iexc.why() << endl;
+        return 1;
+    }
+
+    return 0;
+}